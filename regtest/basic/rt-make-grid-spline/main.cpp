@@ -0,0 +1,86 @@
+#include "plumed/tools/Grid.h"
+#include "plumed/tools/Random.h"
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace PLMD;
+
+// micro-benchmark of the spline interpolation of the grids: the kernels that are
+// specialized for the dimension are compared with the generic implementation,
+// the results should be identical while the timings are only written to the screen
+
+class BenchmarkGrid : public Grid {
+public:
+  BenchmarkGrid(const std::vector<std::string> &names, const std::vector<std::string> & gmin,
+                const std::vector<std::string> & gmax, const std::vector<unsigned> & nbin,
+                const std::vector<bool> &isperiodic, const std::vector<std::string> &pmin, const std::vector<std::string> &pmax):
+    Grid("f",names,gmin,gmax,nbin,true,true,true,isperiodic,pmin,pmax) {}
+  double getGenericValueAndDerivatives(const std::vector<double> & x, std::vector<double>& der) const {
+    return getSplineValueAndDerivativesGeneric(x,der);
+  }
+};
+
+int main() {
+  std::ofstream ofs("output");
+  Random rnd;
+  rnd.setSeed(-1234);
+  const unsigned npoints=20000;
+
+  for(unsigned dim=1; dim<=4; dim++) {
+    std::vector<std::string> names(dim), gmin(dim), gmax(dim), pmin(dim), pmax(dim);
+    std::vector<unsigned> nbin(dim);
+    std::vector<bool> isperiodic(dim);
+    for(unsigned k=0; k<dim; k++) {
+      names[k]="x"+std::to_string(k);
+      // every second dimension is periodic
+      isperiodic[k]=(k%2==1);
+      gmin[k]="-3.0"; gmax[k]="3.0";
+      pmin[k]="-pi"; pmax[k]="pi";
+      nbin[k]=(dim<4 ? 40 : 15);
+    }
+    BenchmarkGrid grid(names,gmin,gmax,nbin,isperiodic,pmin,pmax);
+    std::vector<double> der(dim);
+    for(Grid::index_t i=0; i<grid.getSize(); i++) {
+      std::vector<double> x=grid.getPoint(i);
+      double value=1.0;
+      for(unsigned k=0; k<dim; k++) {value*=2.0+std::sin(x[k]);}
+      for(unsigned k=0; k<dim; k++) {der[k]=value/(2.0+std::sin(x[k]))*std::cos(x[k]);}
+      grid.setValueAndDerivatives(i,value,der);
+    }
+    std::vector<std::vector<double> > points(npoints,std::vector<double>(dim));
+    for(unsigned i=0; i<npoints; i++) {
+      for(unsigned k=0; k<dim; k++) {
+        double lo=(isperiodic[k] ? -M_PI : -3.0);
+        double hi=(isperiodic[k] ? M_PI : 3.0);
+        points[i][k]=lo+(hi-lo)*rnd.RandU01();
+      }
+    }
+    // check that the results are identical
+    unsigned ndiff=0;
+    double sum=0.0;
+    std::vector<double> der_generic(dim);
+    for(unsigned i=0; i<npoints; i++) {
+      double value=grid.getValueAndDerivatives(points[i],der);
+      double value_generic=grid.getGenericValueAndDerivatives(points[i],der_generic);
+      if(value!=value_generic) ndiff++;
+      for(unsigned k=0; k<dim; k++) {if(der[k]!=der_generic[k]) ndiff++;}
+      sum+=value;
+    }
+    ofs<<"dimension "<<dim<<": "<<ndiff<<" differences, average value "<<sum/npoints<<"\n";
+    // timings
+    double check=0.0;
+    std::chrono::high_resolution_clock::time_point t0=std::chrono::high_resolution_clock::now();
+    for(unsigned i=0; i<npoints; i++) {check+=grid.getGenericValueAndDerivatives(points[i],der_generic);}
+    std::chrono::high_resolution_clock::time_point t1=std::chrono::high_resolution_clock::now();
+    for(unsigned i=0; i<npoints; i++) {check-=grid.getValueAndDerivatives(points[i],der);}
+    std::chrono::high_resolution_clock::time_point t2=std::chrono::high_resolution_clock::now();
+    double generic_ns=std::chrono::duration<double,std::nano>(t1-t0).count()/npoints;
+    double specialized_ns=std::chrono::duration<double,std::nano>(t2-t1).count()/npoints;
+    std::cout<<"dimension "<<dim<<": generic "<<generic_ns<<" ns/call, specialized "<<specialized_ns<<" ns/call, speedup "<<generic_ns/specialized_ns<<" (check "<<check<<")\n";
+  }
+  return 0;
+}
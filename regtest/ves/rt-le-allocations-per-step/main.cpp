@@ -0,0 +1,87 @@
+#include "plumed/core/PlumedMain.h"
+#include "plumed/core/ActionSet.h"
+#include "plumed/core/Action.h"
+#include "plumed/tools/File.h"
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+// Counts the heap allocations done while evaluating a VES bias.
+// The global operator new is replaced such that every allocation done
+// while counting is active is registered.
+
+static bool count_allocations=false;
+static unsigned long number_of_allocations=0;
+
+void* operator new(std::size_t size) {
+  if(count_allocations) number_of_allocations++;
+  void* p=std::malloc(size>0 ? size : 1);
+  if(!p) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+using namespace PLMD;
+
+void step(PlumedMain& p,int natoms,int istep,std::vector<double>& positions) {
+  std::vector<double> masses(natoms,1.0);
+  std::vector<double> forces(3*natoms,0.0);
+  std::vector<double> box(9,0.0);
+  std::vector<double> virial(9,0.0);
+  p.cmd("setStep",&istep);
+  p.cmd("setPositions",&positions[0]);
+  p.cmd("setBox",&box[0]);
+  p.cmd("setForces",&forces[0]);
+  p.cmd("setVirial",&virial[0]);
+  p.cmd("setMasses",&masses[0]);
+  p.cmd("calc");
+}
+
+int main() {
+  int natoms=4;
+  PlumedMain p;
+  p.cmd("setNatoms",&natoms);
+  p.cmd("setMDEngine","regtest");
+  p.cmd("setLogFile","test.log");
+  p.cmd("init");
+  p.readInputLine("d1: DISTANCE ATOMS=1,2");
+  p.readInputLine("d2: DISTANCE ATOMS=3,4");
+  p.readInputLine("bf1: BF_LEGENDRE ORDER=20 MINIMUM=0.0 MAXIMUM=4.0");
+  p.readInputLine("bf2: BF_CHEBYSHEV ORDER=15 MINIMUM=0.0 MAXIMUM=4.0");
+  p.readInputLine("b1: VES_LINEAR_EXPANSION ARG=d1,d2 BASIS_FUNCTIONS=bf1,bf2 TEMP=300.0 GRID_BINS=20");
+  p.readInputLine("b2: VES_LINEAR_EXPANSION ARG=d1,d2 BASIS_FUNCTIONS=bf1,bf2 TEMP=300.0 GRID_BINS=20 SEPARABLE_EVALUATION");
+  p.readInputLine("b3: VES_LINEAR_EXPANSION ARG=d1,d2 BASIS_FUNCTIONS=bf1,bf2 TEMP=300.0 GRID_BINS=20 BIAS_CUTOFF=10.0");
+  // large enough to be split among the threads (see config)
+  p.readInputLine("bf3: BF_LEGENDRE ORDER=60 MINIMUM=0.0 MAXIMUM=4.0");
+  p.readInputLine("bf4: BF_CHEBYSHEV ORDER=60 MINIMUM=0.0 MAXIMUM=4.0");
+  p.readInputLine("b4: VES_LINEAR_EXPANSION ARG=d1,d2 BASIS_FUNCTIONS=bf3,bf4 TEMP=300.0 GRID_BINS=20");
+  p.readInputLine("o1: OPT_AVERAGED_SGD BIAS=b1,b2,b3,b4 STRIDE=5 STEPSIZE=1.0 TARGETDIST_STRIDE=5");
+
+  std::vector<double> positions(3*natoms,0.0);
+  positions[3]=1.1; positions[9]=2.3;
+
+  // a few steps to reach the steady state
+  for(int i=0; i<10; i++) {
+    positions[3]+=0.05; positions[9]-=0.05;
+    step(p,natoms,i,positions);
+  }
+
+  OFile out;
+  out.open("output");
+  const std::vector<std::string> labels={"b1","b2","b3","b4"};
+  const unsigned nsteps=100;
+  for(unsigned k=0; k<labels.size(); k++) {
+    Action* bias=p.getActionSet().selectWithLabel<Action*>(labels[k]);
+    number_of_allocations=0;
+    count_allocations=true;
+    for(unsigned i=0; i<nsteps; i++) {bias->calculate();}
+    count_allocations=false;
+    out.printf("%s allocations per step: %g\n",labels[k].c_str(),static_cast<double>(number_of_allocations)/nsteps);
+  }
+  out.close();
+  return 0;
+}
@@ -29,6 +29,7 @@
 #include "core/FlexibleBin.h"
 #include "tools/Matrix.h"
 #include "tools/Random.h"
+#include "tools/OpenMP.h"
 #include <string>
 #include <cstring>
 #include "tools/File.h"
@@ -36,6 +37,8 @@
 #include <limits>
 #include <ctime>
 #include <memory>
+#include <map>
+#include <algorithm>
 
 #define DP2CUTOFF 6.25
 
@@ -363,6 +366,14 @@ private:
   vector<double> sigma0min_;
   vector<double> sigma0max_;
   vector<Gaussian> hills_;
+  // cell list over the centers of the hills, used to evaluate the bias without grid.
+  // the cells are at least as wide as the extent of any indexed hill
+  vector<double> hill_cell_width_;
+  vector<unsigned> hill_cell_nperiodic_; // number of cells along periodic arguments, 0 otherwise
+  std::map<vector<long>, vector<unsigned> > hill_cells_;
+  vector<bool> hill_indexed_;
+  vector<unsigned> unindexed_hills_; // hills that are not localized along all the arguments
+  vector<unsigned> hills_around_; // buffer for the hills close to the current point
   OFile hillsOfile_;
   OFile gridfile_;
   std::unique_ptr<Grid> BiasGrid_;
@@ -416,12 +427,17 @@ private:
   void   readGaussians(IFile*);
   void   writeGaussian(const Gaussian&,OFile&);
   void   addGaussian(const Gaussian&);
+  void   addSeparableGaussian(const Gaussian&);
   double getHeight(const vector<double>&);
   void   temperHeight(double &height, const TemperingSpecs &t_specs, const double tempering_bias);
   double getBiasAndDerivatives(const vector<double>&,double* der=NULL);
-  double evaluateGaussian(const vector<double>&, const Gaussian&,double* der=NULL);
+  double evaluateGaussian(const vector<double>&, const Gaussian&,double* der=NULL,double* dp_buffer=NULL);
   double getGaussianNormalization( const Gaussian& );
   vector<unsigned> getGaussianSupport(const Gaussian&);
+  bool   getGaussianExtent(const Gaussian&, vector<double>&);
+  vector<long> getHillCell(const vector<double>&);
+  void   storeHill(const Gaussian&);
+  void   getHillsAround(const vector<double>&, vector<unsigned>&);
   bool   scanOneHill(IFile *ifile,  vector<Value> &v, vector<double> &center, vector<double>  &sigma, double &height, bool &multivariate);
   void   computeReweightingFactor();
   double getTransitionBarrierBias();
@@ -1288,40 +1304,135 @@ void MetaD::writeGaussian(const Gaussian& hill, OFile&file)
 
 void MetaD::addGaussian(const Gaussian& hill)
 {
-  if(!grid_) hills_.push_back(hill);
+  if(!grid_) storeHill(hill);
+  else if(!hill.multivariate && !doInt_) addSeparableGaussian(hill);
   else {
     unsigned ncv=getNumberOfArguments();
     vector<unsigned> nneighb=getGaussianSupport(hill);
     vector<Grid::index_t> neighbors=BiasGrid_->getNeighbors(hill.center,nneighb);
-    vector<double> der(ncv);
-    vector<double> xx(ncv);
-    if(comm.Get_size()==1) {
+    // value and derivatives for each neighbor, in the layout used by Grid::addBlock
+    const unsigned nvalues=ncv+1;
+    vector<double> block(nvalues*neighbors.size(),0.0);
+    unsigned nt=OpenMP::getNumThreads();
+    if(nt*10>neighbors.size()) nt=neighbors.size()/10;
+    if(nt==0) nt=1;
+    // all the ranks hold the same grid, so each rank evaluates all the points
+    // (split among threads) and no communication is required
+    #pragma omp parallel num_threads(nt)
+    {
+      vector<double> xx(ncv);
+      vector<double> dp(ncv);
+      #pragma omp for
       for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        for(unsigned j=0; j<ncv; ++j) der[j]=0.0;
-        BiasGrid_->getPoint(ineigh,xx);
-        double bias=evaluateGaussian(xx,hill,&der[0]);
-        BiasGrid_->addValueAndDerivatives(ineigh,bias,der);
+        BiasGrid_->getPoint(neighbors[i],xx);
+        block[nvalues*i]=evaluateGaussian(xx,hill,&block[nvalues*i+1],&dp[0]);
       }
-    } else {
-      unsigned stride=comm.Get_size();
-      unsigned rank=comm.Get_rank();
-      vector<double> allder(ncv*neighbors.size(),0.0);
-      vector<double> allbias(neighbors.size(),0.0);
-      for(unsigned i=rank; i<neighbors.size(); i+=stride) {
-        Grid::index_t ineigh=neighbors[i];
-        BiasGrid_->getPoint(ineigh,xx);
-        allbias[i]=evaluateGaussian(xx,hill,&allder[ncv*i]);
+    }
+    // neighbors are ordered with the first argument running fastest,
+    // so they form runs of consecutive grid points that are added at once
+    for(unsigned i=0; i<neighbors.size();) {
+      unsigned n=1;
+      while(i+n<neighbors.size() && neighbors[i+n]==neighbors[i]+n) n++;
+      BiasGrid_->addBlock(neighbors[i],n,&block[nvalues*i]);
+      i+=n;
+    }
+  }
+}
+
+// for diagonal hills the gaussian is the product of one-dimensional gaussians,
+// so only one exponential per grid point along each argument is needed.
+// all the ranks compute the whole hill (split among threads), no communication is required.
+void MetaD::addSeparableGaussian(const Gaussian& hill)
+{
+  unsigned ncv=getNumberOfArguments();
+  vector<unsigned> nneighb=getGaussianSupport(hill);
+  vector<unsigned> nbin=BiasGrid_->getNbin();
+  vector<bool> isperiodic=BiasGrid_->getIsPeriodic();
+  vector<unsigned> indices=BiasGrid_->getIndices(hill.center);
+  vector<unsigned> point_indices(indices);
+  vector<double> xx(ncv);
+  // one-dimensional stencils: offset of the grid index, scaled distance
+  // from the center and gaussian factor for each point along each argument
+  vector<vector<Grid::index_t> > offset(ncv);
+  vector<vector<double> > dp(ncv), gauss(ncv);
+  Grid::index_t stride=1;
+  for(unsigned i=0; i<ncv; ++i) {
+    const int n=nbin[i];
+    for(unsigned k=0; k<2*nneighb[i]+1; ++k) {
+      int i0=static_cast<int>(k+indices[i])-static_cast<int>(nneighb[i]);
+      if(!isperiodic[i] && (i0<0 || i0>=n)) continue;
+      if(isperiodic[i]) i0=((i0%n)+n)%n;
+      point_indices[i]=i0;
+      BiasGrid_->getPoint(point_indices,xx);
+      double dpi=difference(i,hill.center[i],xx[i])*hill.invsigma[i];
+      offset[i].push_back(i0*stride);
+      dp[i].push_back(dpi);
+      gauss[i].push_back(exp(-0.5*dpi*dpi));
+    }
+    if(offset[i].empty()) return;
+    point_indices[i]=indices[i];
+    stride*=nbin[i];
+  }
+
+  // the points are computed one row along the first argument at a time,
+  // in the layout used by Grid::addBlock
+  const unsigned nvalues=ncv+1;
+  const unsigned nrow=offset[0].size();
+  unsigned nrows=1;
+  for(unsigned i=1; i<ncv; ++i) nrows*=offset[i].size();
+  vector<double> block(nvalues*nrow*nrows);
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*100>nrow*nrows) nt=nrow*nrows/100;
+  if(nt>nrows) nt=nrows;
+  if(nt==0) nt=1;
+  #pragma omp parallel num_threads(nt)
+  {
+    vector<unsigned> pos(ncv,0);
+    #pragma omp for
+    for(unsigned r=0; r<nrows; ++r) {
+      unsigned rr=r;
+      for(unsigned i=1; i<ncv; ++i) {
+        pos[i]=rr%offset[i].size();
+        rr/=offset[i].size();
       }
-      comm.Sum(allbias);
-      comm.Sum(allder);
-      for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        for(unsigned j=0; j<ncv; ++j) {der[j]=allder[ncv*i+j];}
-        BiasGrid_->addValueAndDerivatives(ineigh,allbias[i],der);
+      double gauss_outer=1.0;
+      for(unsigned i=1; i<ncv; ++i) gauss_outer*=gauss[i][pos[i]];
+      double* row=&block[nvalues*nrow*r];
+      for(unsigned k=0; k<nrow; ++k) {
+        double* point=row+nvalues*k;
+        // same truncation as in evaluateGaussian
+        double dp2=dp[0][k]*dp[0][k];
+        for(unsigned i=1; i<ncv; ++i) dp2+=dp[i][pos[i]]*dp[i][pos[i]];
+        dp2*=0.5;
+        if(dp2<DP2CUTOFF) {
+          double bias=hill.height*gauss[0][k]*gauss_outer;
+          point[0]=bias;
+          point[1]=-bias*dp[0][k]*hill.invsigma[0];
+          for(unsigned i=1; i<ncv; ++i) point[1+i]=-bias*dp[i][pos[i]]*hill.invsigma[i];
+        } else {
+          for(unsigned j=0; j<nvalues; ++j) point[j]=0.0;
+        }
       }
     }
   }
+
+  // a row is contiguous in the grid unless it wraps around a periodic boundary
+  vector<unsigned> pos(ncv,0);
+  for(unsigned r=0; r<nrows; ++r) {
+    Grid::index_t index=0;
+    for(unsigned i=1; i<ncv; ++i) index+=offset[i][pos[i]];
+    const double* row=&block[nvalues*nrow*r];
+    for(unsigned k=0; k<nrow;) {
+      unsigned n=1;
+      while(k+n<nrow && offset[0][k+n]==offset[0][k]+n) n++;
+      BiasGrid_->addBlock(index+offset[0][k],n,row+nvalues*k);
+      k+=n;
+    }
+    for(unsigned i=1; i<ncv; ++i) {
+      if(++pos[i]<offset[i].size()) break;
+      pos[i]=0;
+    }
+  }
 }
 
 vector<unsigned> MetaD::getGaussianSupport(const Gaussian& hill)
@@ -1378,6 +1489,137 @@ vector<unsigned> MetaD::getGaussianSupport(const Gaussian& hill)
   return nneigh;
 }
 
+// half widths of the box around the center outside which the hill is truncated,
+// returns false if the hill is not localized along some argument
+bool MetaD::getGaussianExtent(const Gaussian& hill, vector<double>& extent)
+{
+  unsigned ncv=getNumberOfArguments();
+  extent.assign(ncv,0.0);
+  if(hill.multivariate) {
+    unsigned k=0;
+    Matrix<double> mymatrix(ncv,ncv);
+    for(unsigned i=0; i<ncv; i++) {
+      for(unsigned j=i; j<ncv; j++) {
+        mymatrix(i,j)=mymatrix(j,i)=hill.sigma[k];
+        k++;
+      }
+    }
+    // the box enclosing the ellipsoid 0.5*dp^T*mymatrix*dp<DP2CUTOFF
+    Matrix<double> myinv(ncv,ncv);
+    if(Invert(mymatrix,myinv)!=0) return false;
+    for(unsigned i=0; i<ncv; i++) {
+      if(!(myinv(i,i)>0.0) || std::isinf(myinv(i,i))) return false;
+      extent[i]=sqrt(2.0*DP2CUTOFF*myinv(i,i));
+    }
+  } else {
+    for(unsigned i=0; i<ncv; i++) {
+      // zero widths are not truncated along that argument, see Gaussian
+      if(hill.invsigma[i]==0.0) return false;
+      extent[i]=sqrt(2.0*DP2CUTOFF)*std::abs(hill.sigma[i]);
+    }
+  }
+  return true;
+}
+
+vector<long> MetaD::getHillCell(const vector<double>& x)
+{
+  unsigned ncv=getNumberOfArguments();
+  vector<long> cell(ncv);
+  for(unsigned i=0; i<ncv; i++) {
+    if(hill_cell_nperiodic_[i]>0) {
+      double min,max;
+      getPntrToArgument(i)->getDomain(min,max);
+      double period=max-min;
+      double t=x[i]-min;
+      t-=period*floor(t/period);
+      long c=static_cast<long>(floor(t/period*hill_cell_nperiodic_[i]));
+      if(c<0) c=0;
+      if(c>=static_cast<long>(hill_cell_nperiodic_[i])) c=hill_cell_nperiodic_[i]-1;
+      cell[i]=c;
+    } else {
+      cell[i]=static_cast<long>(floor(x[i]/hill_cell_width_[i]));
+    }
+  }
+  return cell;
+}
+
+void MetaD::storeHill(const Gaussian& hill)
+{
+  unsigned ncv=getNumberOfArguments();
+  vector<double> extent;
+  if(!getGaussianExtent(hill,extent)) {
+    unindexed_hills_.push_back(hills_.size());
+    hill_indexed_.push_back(false);
+    hills_.push_back(hill);
+    return;
+  }
+  if(hill_cell_width_.empty()) {
+    hill_cell_width_.assign(ncv,0.0);
+    hill_cell_nperiodic_.assign(ncv,0);
+  }
+  bool rebuild=false;
+  for(unsigned i=0; i<ncv; i++) {
+    if(extent[i]>hill_cell_width_[i]) {
+      // some margin to avoid rebuilding too often with adaptive widths
+      hill_cell_width_[i]=1.25*extent[i];
+      if(getPntrToArgument(i)->isPeriodic()) {
+        double min,max;
+        getPntrToArgument(i)->getDomain(min,max);
+        hill_cell_nperiodic_[i]=static_cast<unsigned>(floor((max-min)/hill_cell_width_[i]));
+        if(hill_cell_nperiodic_[i]==0) hill_cell_nperiodic_[i]=1;
+      }
+      rebuild=true;
+    }
+  }
+  if(rebuild) {
+    hill_cells_.clear();
+    for(unsigned j=0; j<hills_.size(); j++) {
+      if(hill_indexed_[j]) hill_cells_[getHillCell(hills_[j].center)].push_back(j);
+    }
+  }
+  hill_cells_[getHillCell(hill.center)].push_back(hills_.size());
+  hill_indexed_.push_back(true);
+  hills_.push_back(hill);
+}
+
+// indices of the hills that can be within the cutoff from cv, in increasing order
+void MetaD::getHillsAround(const vector<double>& cv, vector<unsigned>& list)
+{
+  list.assign(unindexed_hills_.begin(),unindexed_hills_.end());
+  if(!hill_cells_.empty()) {
+    unsigned ncv=getNumberOfArguments();
+    vector<double> x(cv);
+    // the bias is evaluated at the boundary of the interval
+    if(doInt_) x[0]=std::min(std::max(x[0],lowI_),uppI_);
+    vector<long> center=getHillCell(x);
+    // the cells to visit along each argument
+    vector<vector<long> > range(ncv);
+    for(unsigned i=0; i<ncv; i++) {
+      long n=hill_cell_nperiodic_[i];
+      if(n>0 && n<3) {
+        for(long c=0; c<n; c++) range[i].push_back(c);
+      } else {
+        for(long c=center[i]-1; c<=center[i]+1; c++) range[i].push_back(n>0 ? (c+n)%n : c);
+      }
+    }
+    vector<unsigned> pos(ncv,0);
+    vector<long> cell(ncv);
+    while(true) {
+      for(unsigned i=0; i<ncv; i++) cell[i]=range[i][pos[i]];
+      const auto it=hill_cells_.find(cell);
+      if(it!=hill_cells_.end()) list.insert(list.end(),it->second.begin(),it->second.end());
+      unsigned i=0;
+      for(; i<ncv; i++) {
+        if(++pos[i]<range[i].size()) break;
+        pos[i]=0;
+      }
+      if(i==ncv) break;
+    }
+  }
+  // same order of summation as when looping over all the hills
+  std::sort(list.begin(),list.end());
+}
+
 double MetaD::getBiasAndDerivatives(const vector<double>& cv, double* der)
 {
   double bias=0.0;
@@ -1389,13 +1631,41 @@ double MetaD::getBiasAndDerivatives(const vector<double>& cv, double* der)
       warning(msg);
       last_step_warn_grid=getStep();
     }
-    unsigned stride=comm.Get_size();
-    unsigned rank=comm.Get_rank();
-    for(unsigned i=rank; i<hills_.size(); i+=stride) {
-      bias+=evaluateGaussian(cv,hills_[i],der);
+    unsigned ncv=getNumberOfArguments();
+    // only the hills close to cv contribute
+    vector<unsigned>& hills_around(hills_around_);
+    getHillsAround(cv,hills_around);
+    unsigned nt=OpenMP::getNumThreads();
+    if(nt*10>hills_around.size()) nt=hills_around.size()/10;
+    if(nt==0) nt=1;
+    // all the ranks hold the same hills, so each rank sums all of them and
+    // no communication is required
+    if(nt>1) {
+      // the partial sums of the threads are combined in a fixed order to get the same result on all ranks
+      vector<double> omp_bias(nt,0.0);
+      vector<vector<double> > omp_der(nt,vector<double>(ncv,0.0));
+      #pragma omp parallel num_threads(nt)
+      {
+        unsigned t=OpenMP::getThreadNum();
+        double tbias=0.0;
+        vector<double> tder(ncv,0.0);
+        vector<double> dp(ncv);
+        #pragma omp for schedule(static)
+        for(unsigned i=0; i<hills_around.size(); ++i) {
+          tbias+=evaluateGaussian(cv,hills_[hills_around[i]],(der ? &tder[0] : NULL),&dp[0]);
+        }
+        omp_bias[t]=tbias;
+        omp_der[t]=tder;
+      }
+      for(unsigned t=0; t<nt; ++t) {
+        bias+=omp_bias[t];
+        if(der) for(unsigned i=0; i<ncv; ++i) der[i]+=omp_der[t][i];
+      }
+    } else {
+      for(unsigned i=0; i<hills_around.size(); ++i) {
+        bias+=evaluateGaussian(cv,hills_[hills_around[i]],der);
+      }
     }
-    comm.Sum(bias);
-    if(der) comm.Sum(der,getNumberOfArguments());
   } else {
     if(der) {
       vector<double> vder(getNumberOfArguments());
@@ -1433,8 +1703,10 @@ double MetaD::getGaussianNormalization( const Gaussian& hill )
   return norm*pow(2*pi,static_cast<double>(ncv)/2.0);
 }
 
-double MetaD::evaluateGaussian(const vector<double>& cv, const Gaussian& hill, double* der)
+double MetaD::evaluateGaussian(const vector<double>& cv, const Gaussian& hill, double* der, double* dp_buffer)
 {
+  // scratch space for the distances, each thread has to pass its own buffer
+  double* pdp=(dp_buffer ? dp_buffer : dp_.get());
   double dp2=0.0;
   double bias=0.0;
   // I use a pointer here because cv is const (and should be const)
@@ -1463,7 +1735,7 @@ double MetaD::evaluateGaussian(const vector<double>& cv, const Gaussian& hill, d
     }
     for(unsigned i=0; i<cv.size(); ++i) {
       double dp_i=difference(i,hill.center[i],pcv[i]);
-      dp_[i]=dp_i;
+      pdp[i]=dp_i;
       for(unsigned j=i; j<cv.size(); ++j) {
         if(i==j) {
           dp2+=dp_i*dp_i*mymatrix(i,j)*0.5;
@@ -1479,7 +1751,7 @@ double MetaD::evaluateGaussian(const vector<double>& cv, const Gaussian& hill, d
         for(unsigned i=0; i<cv.size(); ++i) {
           double tmp=0.0;
           for(unsigned j=0; j<cv.size(); ++j) {
-            tmp += dp_[j]*mymatrix(i,j)*bias;
+            tmp += pdp[j]*mymatrix(i,j)*bias;
           }
           der[i]-=tmp;
         }
@@ -1489,13 +1761,13 @@ double MetaD::evaluateGaussian(const vector<double>& cv, const Gaussian& hill, d
     for(unsigned i=0; i<cv.size(); ++i) {
       double dp=difference(i,hill.center[i],pcv[i])*hill.invsigma[i];
       dp2+=dp*dp;
-      dp_[i]=dp;
+      pdp[i]=dp;
     }
     dp2*=0.5;
     if(dp2<DP2CUTOFF) {
       bias=hill.height*exp(-dp2);
       if(der) {
-        for(unsigned i=0; i<cv.size(); ++i) {der[i]+=-bias*dp_[i]*hill.invsigma[i];}
+        for(unsigned i=0; i<cv.size(); ++i) {der[i]+=-bias*pdp[i]*hill.invsigma[i];}
       }
     }
   }
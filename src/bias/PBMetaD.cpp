@@ -822,33 +822,22 @@ void PBMetaD::addGaussian(unsigned iarg, const Gaussian& hill)
   else {
     vector<unsigned> nneighb=getGaussianSupport(iarg, hill);
     vector<Grid::index_t> neighbors=BiasGrids_[iarg]->getNeighbors(hill.center,nneighb);
-    vector<double> der(1);
     vector<double> xx(1);
-    if(comm.Get_size()==1) {
-      for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        der[0]=0.0;
-        BiasGrids_[iarg]->getPoint(ineigh,xx);
-        double bias=evaluateGaussian(iarg,xx,hill,&der[0]);
-        BiasGrids_[iarg]->addValueAndDerivatives(ineigh,bias,der);
-      }
-    } else {
-      unsigned stride=comm.Get_size();
-      unsigned rank=comm.Get_rank();
-      vector<double> allder(neighbors.size(),0.0);
-      vector<double> allbias(neighbors.size(),0.0);
-      for(unsigned i=rank; i<neighbors.size(); i+=stride) {
-        Grid::index_t ineigh=neighbors[i];
-        BiasGrids_[iarg]->getPoint(ineigh,xx);
-        allbias[i]=evaluateGaussian(iarg,xx,hill,&allder[i]);
-      }
-      comm.Sum(allbias);
-      comm.Sum(allder);
-      for(unsigned i=0; i<neighbors.size(); ++i) {
-        Grid::index_t ineigh=neighbors[i];
-        der[0]=allder[i];
-        BiasGrids_[iarg]->addValueAndDerivatives(ineigh,allbias[i],der);
-      }
+    // value and derivative for each neighbor, in the layout used by Grid::addBlock
+    vector<double> block(2*neighbors.size(),0.0);
+    unsigned stride=comm.Get_size();
+    unsigned rank=comm.Get_rank();
+    for(unsigned i=rank; i<neighbors.size(); i+=stride) {
+      BiasGrids_[iarg]->getPoint(neighbors[i],xx);
+      block[2*i]=evaluateGaussian(iarg,xx,hill,&block[2*i+1]);
+    }
+    if(stride>1) comm.Sum(block);
+    // the neighbors are consecutive grid points unless they wrap around a periodic boundary
+    for(unsigned i=0; i<neighbors.size();) {
+      unsigned n=1;
+      while(i+n<neighbors.size() && neighbors[i+n]==neighbors[i]+n) n++;
+      BiasGrids_[iarg]->addBlock(neighbors[i],n,&block[2*i]);
+      i+=n;
     }
   }
 }
@@ -0,0 +1,383 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2014-2018 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "CLTool.h"
+#include "CLToolRegister.h"
+#include "core/PlumedMain.h"
+#include "core/Profiler.h"
+#include "tools/Communicator.h"
+#include "tools/IFile.h"
+#include "tools/OpenMP.h"
+#include "tools/Random.h"
+#include "tools/Tools.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace PLMD {
+namespace cltools {
+
+//+PLUMEDOC TOOLS benchmark
+/*
+benchmark measures the time required by PLUMED to calculate an input file, independently of the MD code.
+
+The atoms are placed on a simple cubic lattice, at random positions in a cubic box,
+or read from a trajectory in xyz format that is kept in memory and replayed cyclically.
+The input file is then calculated for a number of steps through the same interface that is used by MD codes,
+and the wall time of each step is measured.
+At the end, the tool reports percentiles of the time per step, the average time per step spent by
+each action in the calculate, apply and update phases, the time spent in MPI collective operations
+and the amount of data shared with the MD code. The first steps can be excluded from the statistics with --nwarmup.
+
+With --shuffle-stride the atoms are passed to PLUMED in random order, and the order is changed
+every given number of steps, as done by MD codes using domain decomposition.
+When running with MPI, atoms are also randomly redistributed among the processes.
+
+With --threads the whole benchmark is repeated for each of the given numbers of OpenMP threads,
+and a table with the speedups is printed at the end.
+
+The PLUMED log is written on the file given with --log. Files written by the actions
+in the input (e.g. by \ref PRINT) are written as usual, and backed up at each repetition.
+
+\par Examples
+
+The following command measures the cost of plumed.dat on 10000 atoms placed on a lattice, using 1, 2, and 4 threads
+\verbatim
+plumed benchmark --plumed plumed.dat --natoms 10000 --nsteps 500 --threads 1,2,4
+\endverbatim
+
+The following command replays the frames of a trajectory, and shuffles the atoms every 10 steps
+\verbatim
+plumed benchmark --plumed plumed.dat --ixyz traj.xyz --nsteps 1000 --shuffle-stride 10
+\endverbatim
+
+*/
+//+ENDPLUMEDOC
+
+class Benchmark:
+  public CLTool
+{
+/// Positions and box of a single frame
+  struct Frame {
+    std::vector<double> positions;
+    std::vector<double> box;
+  };
+/// Timings obtained with a given number of threads
+  struct Result {
+    unsigned threads;
+    std::vector<double> latencies;
+    std::vector<Profiler::Total> totals;
+    double mpiTime;
+    unsigned long long sharedBytes;
+  };
+  std::string plumedFile;
+  double timestep;
+  int natoms;
+  long int nsteps;
+  long int nwarmup;
+  int shuffleStride;
+  int seed;
+  std::vector<Frame> frames;
+/// Read all the frames of an xyz file
+  void readTrajectory(const std::string&);
+/// Create a single frame with atoms on a lattice or at random positions
+  void createFrame(const std::string&,double spacing);
+/// Run the benchmark with a given number of threads
+  Result run(unsigned threads,FILE*log,Communicator&pc);
+/// Print the statistics of a single run
+  void report(const Result&,FILE*out)const;
+public:
+  static void registerKeywords( Keywords& keys );
+  explicit Benchmark(const CLToolOptions& co );
+  int main(FILE* in, FILE*out,Communicator& pc);
+  string description()const {
+    return "measure the time required to calculate a plumed input";
+  }
+};
+
+PLUMED_REGISTER_CLTOOL(Benchmark,"benchmark")
+
+void Benchmark::registerKeywords( Keywords& keys ) {
+  CLTool::registerKeywords( keys );
+  keys.add("compulsory","--plumed","plumed.dat","specify the name of the plumed input file");
+  keys.add("compulsory","--nsteps","100","the number of steps used to collect statistics");
+  keys.add("compulsory","--nwarmup","10","the number of steps calculated before collecting statistics");
+  keys.add("compulsory","--natoms","1000","the number of atoms, unless they are read from a trajectory");
+  keys.add("compulsory","--configuration","lattice","how atoms are placed when they are not read from a trajectory, either lattice or random");
+  keys.add("compulsory","--spacing","0.3","the distance between neighboring lattice points, in nm. Random configurations have the same density");
+  keys.add("optional","--ixyz","a trajectory in xyz format that is read in memory and replayed");
+  keys.add("compulsory","--timestep","0.002","the timestep in picoseconds");
+  keys.add("compulsory","--shuffle-stride","0","shuffle the atoms every this number of steps, as done with domain decomposition (0 means never)");
+  keys.add("compulsory","--seed","1","the seed of the random number generator");
+  keys.add("compulsory","--threads","1","comma-separated list of numbers of OpenMP threads to be tested");
+  keys.add("compulsory","--log","benchmark.log","the file on which the PLUMED log is written");
+}
+
+Benchmark::Benchmark(const CLToolOptions& co ):
+  CLTool(co),
+  timestep(0.002),
+  natoms(0),
+  nsteps(0),
+  nwarmup(0),
+  shuffleStride(0),
+  seed(1)
+{
+  inputdata=commandline;
+}
+
+void Benchmark::readTrajectory(const std::string&file) {
+  IFile ifile;
+  ifile.open(file);
+  std::string line;
+  while(ifile.getline(line)) {
+    std::vector<std::string> words=Tools::getWords(line);
+    if(words.empty()) continue;
+    int n;
+    if(!Tools::convert(words[0],n)) error("cannot read the number of atoms in file "+file);
+    if(frames.empty()) natoms=n;
+    else if(n!=natoms) error("all the frames in file "+file+" should have the same number of atoms");
+    Frame frame;
+    frame.box.assign(9,0.0);
+    frame.positions.resize(3*natoms);
+    if(!ifile.getline(line)) error("premature end of file "+file);
+    words=Tools::getWords(line);
+// the comment line might contain the box, either orthorhombic or generic
+    if(words.size()==3) {
+      for(unsigned i=0; i<3; i++) Tools::convert(words[i],frame.box[4*i]);
+    } else if(words.size()==9) {
+      for(unsigned i=0; i<9; i++) Tools::convert(words[i],frame.box[i]);
+    }
+    for(int i=0; i<natoms; i++) {
+      if(!ifile.getline(line)) error("premature end of file "+file);
+      words=Tools::getWords(line);
+      if(words.size()<4) error("cannot read atom positions in file "+file);
+      for(unsigned k=0; k<3; k++) Tools::convert(words[k+1],frame.positions[3*i+k]);
+    }
+    frames.push_back(frame);
+  }
+  if(frames.empty()) error("no frame found in file "+file);
+}
+
+void Benchmark::createFrame(const std::string&configuration,double spacing) {
+  unsigned side=1;
+  while(side*side*side<unsigned(natoms)) side++;
+  const double length=side*spacing;
+  Frame frame;
+  frame.box.assign(9,0.0);
+  for(unsigned i=0; i<3; i++) frame.box[4*i]=length;
+  frame.positions.resize(3*natoms);
+  if(configuration=="lattice") {
+    for(int i=0; i<natoms; i++) {
+      frame.positions[3*i+0]=spacing*(i%side);
+      frame.positions[3*i+1]=spacing*((i/side)%side);
+      frame.positions[3*i+2]=spacing*(i/(side*side));
+    }
+  } else if(configuration=="random") {
+    Random rnd;
+    rnd.setSeed(-seed);
+    for(auto & x : frame.positions) x=length*rnd.U01();
+  } else error("--configuration should be either lattice or random");
+  frames.push_back(frame);
+}
+
+Benchmark::Result Benchmark::run(unsigned threads,FILE*log,Communicator&pc) {
+  OpenMP::setNumThreads(threads);
+  Result result;
+  result.threads=threads;
+
+  PlumedMain p;
+  int rr=sizeof(double);
+  p.cmd("setRealPrecision",&rr);
+  if(Communicator::initialized()) p.cmd("setMPIComm",&pc.Get_comm());
+  p.cmd("setMDEngine","benchmark");
+  p.cmd("setTimestep",&timestep);
+  p.cmd("setPlumedDat",plumedFile.c_str());
+  p.cmd("setLog",log);
+  p.cmd("setNatoms",&natoms);
+  p.cmd("init");
+// counters are only accumulated, unless a profile file was requested in the input
+  if(!p.profiler) p.profiler.reset(new Profiler(p,"","JSONL",1));
+
+  const int npe=pc.Get_size();
+  const int rank=pc.Get_rank();
+// without shuffling, each process owns a contiguous block of atoms
+  int nlocal=natoms/npe+(rank<natoms%npe?1:0);
+  int start=rank*(natoms/npe)+std::min(rank,natoms%npe);
+  if(shuffleStride==0 && npe>1) {
+    p.cmd("setAtomsNlocal",&nlocal);
+    p.cmd("setAtomsContiguous",&start);
+  }
+
+  std::vector<double> masses(natoms,1.0);
+  std::vector<double> charges(natoms,0.0);
+  std::vector<double> positions(3*natoms);
+  std::vector<double> forces(3*natoms);
+  std::vector<double> virial(9);
+  std::vector<int> gatindex;
+  std::vector<unsigned> order(natoms);
+  Random rnd;
+  rnd.setSeed(-seed);
+
+  for(long int step=0; step<nwarmup+nsteps; step++) {
+    Frame & frame(frames[step%frames.size()]);
+    const bool shuffle=(shuffleStride>0 && step%shuffleStride==0);
+    if(shuffle) {
+// all the processes generate the same sequence, so that each atom is owned by exactly one process
+      for(int i=0; i<natoms; i++) order[i]=i;
+      rnd.Shuffle(order);
+      gatindex.clear();
+      for(const auto i : order) {
+        int owner=std::floor(rnd.U01()*npe);
+        if(owner>=npe) owner=npe-1;
+        if(owner==rank) gatindex.push_back(i);
+      }
+      nlocal=gatindex.size();
+      start=0;
+    }
+// this is done by the MD code, and is not included in the timing
+    double* pos=&frame.positions[3*start];
+    if(shuffleStride>0) {
+      for(int i=0; i<nlocal; i++) for(unsigned k=0; k<3; k++) positions[3*i+k]=frame.positions[3*gatindex[i]+k];
+      pos=&positions[0];
+    }
+    forces.assign(forces.size(),0.0);
+    virial.assign(9,0.0);
+    int stop=0;
+
+    const auto t0=std::chrono::steady_clock::now();
+    if(shuffle) {
+      p.cmd("setAtomsNlocal",&nlocal);
+      p.cmd("setAtomsGatindex",gatindex.data());
+    }
+    p.cmd("setStepLong",&step);
+    p.cmd("setStopFlag",&stop);
+// for empty domains we pass null pointers
+    p.cmd("setMasses",nlocal>0?&masses[start]:NULL);
+    p.cmd("setCharges",nlocal>0?&charges[start]:NULL);
+    p.cmd("setPositions",nlocal>0?pos:NULL);
+    p.cmd("setForces",nlocal>0?&forces[3*start]:NULL);
+    p.cmd("setBox",&frame.box[0]);
+    p.cmd("setVirial",&virial[0]);
+    p.cmd("calc");
+    const auto t1=std::chrono::steady_clock::now();
+
+    if(step==nwarmup-1) p.profiler->reset();
+    if(step>=nwarmup) result.latencies.push_back(std::chrono::duration<double>(t1-t0).count());
+    if(stop) break;
+  }
+  result.totals=p.profiler->getTotals();
+  result.mpiTime=p.profiler->getCollectiveTime();
+  result.sharedBytes=p.profiler->getSharedBytes();
+  return result;
+}
+
+void Benchmark::report(const Result&result,FILE*out)const {
+  std::vector<double> l(result.latencies);
+  if(l.empty()) return;
+  std::sort(l.begin(),l.end());
+  const unsigned n=l.size();
+  auto percentile=[&](double q) {
+    return 1000.0*l[std::min(n-1,unsigned(std::floor(q*(n-1)+0.5)))];
+  };
+  double mean=0.0;
+  for(const auto & x : l) mean+=x;
+  mean*=1000.0/n;
+  std::fprintf(out,"BENCHMARK: %u threads, time per step (ms) over %u steps\n",result.threads,n);
+  std::fprintf(out,"BENCHMARK: %12s %12s %12s %12s %12s %12s\n","mean","min","p50","p90","p99","max");
+  std::fprintf(out,"BENCHMARK: %12.6f %12.6f %12.6f %12.6f %12.6f %12.6f\n",mean,1000.0*l[0],percentile(0.5),percentile(0.9),percentile(0.99),1000.0*l[n-1]);
+  std::fprintf(out,"BENCHMARK: average time per step (ms)\n");
+  std::fprintf(out,"BENCHMARK: %-30s %-10s %12s %12s %12s\n","action","phase","calls","wall","cpu");
+  for(const auto & t : result.totals) {
+    const std::string label=(t.label.length()>0?t.label:"-");
+    std::fprintf(out,"BENCHMARK: %-30s %-10s %12lu %12.6f %12.6f\n",label.c_str(),t.phase.c_str(),t.calls,1000.0*t.wall/n,1000.0*t.cpu/n);
+  }
+  std::fprintf(out,"BENCHMARK: time in MPI collectives per step (ms): %f\n",1000.0*result.mpiTime/n);
+  std::fprintf(out,"BENCHMARK: bytes shared with the MD code per step: %llu\n",result.sharedBytes/n);
+}
+
+int Benchmark::main(FILE* in, FILE*out,Communicator& pc) {
+  parse("--plumed",plumedFile);
+  parse("--timestep",timestep);
+  parse("--nsteps",nsteps);
+  parse("--nwarmup",nwarmup);
+  if(nsteps<=0) error("--nsteps should be positive");
+  if(nwarmup<0) error("--nwarmup should not be negative");
+  parse("--shuffle-stride",shuffleStride);
+  if(shuffleStride<0) error("--shuffle-stride should not be negative");
+  parse("--seed",seed);
+  std::vector<unsigned> threads;
+  parseVector("--threads",threads);
+  for(const auto t : threads) if(t==0) error("--threads should contain positive numbers");
+  std::string logfile;
+  parse("--log",logfile);
+
+  std::string trajectory;
+  parse("--ixyz",trajectory);
+  if(trajectory.length()>0) {
+    readTrajectory(trajectory);
+  } else {
+    parse("--natoms",natoms);
+    if(natoms<=0) error("--natoms should be positive");
+    std::string configuration;
+    parse("--configuration",configuration);
+    double spacing;
+    parse("--spacing",spacing);
+    createFrame(configuration,spacing);
+  }
+
+  FILE* log=std::fopen(logfile.c_str(),"w");
+  if(!log) error("cannot open file "+logfile);
+  if(pc.Get_rank()==0) {
+    std::fprintf(out,"BENCHMARK: input %s, %d atoms, %u frames\n",plumedFile.c_str(),natoms,unsigned(frames.size()));
+    if(shuffleStride>0) std::fprintf(out,"BENCHMARK: atoms are shuffled every %d steps\n",shuffleStride);
+  }
+  std::vector<Result> results;
+  for(const auto t : threads) {
+    results.push_back(run(t,log,pc));
+    if(pc.Get_rank()==0) report(results.back(),out);
+  }
+  OpenMP::setNumThreads(0);
+  std::fclose(log);
+
+  if(pc.Get_rank()==0 && results.size()>1) {
+    auto mean=[](const Result&r) {
+      double m=0.0;
+      for(const auto & x : r.latencies) m+=x;
+      return r.latencies.size()>0?m/r.latencies.size():0.0;
+    };
+    const double reference=mean(results[0]);
+    std::fprintf(out,"BENCHMARK: scaling\n");
+    std::fprintf(out,"BENCHMARK: %12s %12s %12s\n","threads","mean (ms)","speedup");
+    for(const auto & r : results) {
+      const double m=mean(r);
+      std::fprintf(out,"BENCHMARK: %12u %12.6f %12.3f\n",r.threads,1000.0*m,m>0.0?reference/m:0.0);
+    }
+  }
+  return 0;
+}
+
+}
+}
@@ -104,6 +104,7 @@ public:
 // active methods:
   static void registerKeywords( Keywords& keys );
   virtual double pairing(double distance,double&dfunc,unsigned i,unsigned j)const;
+  virtual void pairingBlock(unsigned n,const unsigned*i0,const unsigned*i1,const double*distance2,double*f,double*dfunc)const;
 };
 
 PLUMED_REGISTER_ACTION(Coordination,"COORDINATION")
@@ -153,6 +154,12 @@ double Coordination::pairing(double distance,double&dfunc,unsigned i,unsigned j)
   return switchingFunction.calculateSqr(distance,dfunc);
 }
 
+void Coordination::pairingBlock(unsigned n,const unsigned*i0,const unsigned*i1,const double*distance2,double*f,double*dfunc)const {
+  (void) i0; // avoid warnings
+  (void) i1; // avoid warnings
+  switchingFunction.calculateSqr(n,distance2,f,dfunc);
+}
+
 }
 
 }
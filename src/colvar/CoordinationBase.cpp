@@ -23,8 +23,11 @@
 #include "tools/NeighborList.h"
 #include "tools/Communicator.h"
 #include "tools/OpenMP.h"
+#include "tools/Tools.h"
 
 #include <string>
+#include <cmath>
+#include <algorithm>
 
 using namespace std;
 
@@ -38,6 +41,11 @@ void CoordinationBase::registerKeywords( Keywords& keys ) {
   keys.addFlag("NLIST",false,"Use a neighbour list to speed up the calculation");
   keys.add("optional","NL_CUTOFF","The cutoff for the neighbour list");
   keys.add("optional","NL_STRIDE","The frequency with which we are updating the atoms in the neighbour list");
+  keys.add("optional","NL_SKIN","Update the neighbour list only when atoms have moved enough that pairs closer than NL_CUTOFF minus NL_SKIN could be missed. "
+           "This replaces NL_STRIDE, but positions of all the atoms are retrieved at every step");
+  keys.add("compulsory","PRECISION","DOUBLE","Precision used to compute distances. DOUBLE computes everything in double precision. "
+           "MIXED computes distances in single precision and accumulates the result in double precision. "
+           "VALIDATE uses DOUBLE but also computes the MIXED result, writing on the log the largest deviation between the two");
   keys.add("atoms","GROUPA","First list of atoms");
   keys.add("atoms","GROUPB","Second list of atoms (if empty, N*(N-1)/2 pairs in GROUPA are counted)");
 }
@@ -47,11 +55,19 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
   pbc(true),
   serial(false),
   invalidateList(true),
-  firsttime(true)
+  firsttime(true),
+  precision(precisionDouble)
 {
 
   parseFlag("SERIAL",serial);
 
+  string prec;
+  parse("PRECISION",prec);
+  if(prec=="DOUBLE") precision=precisionDouble;
+  else if(prec=="MIXED") precision=precisionMixed;
+  else if(prec=="VALIDATE") precision=precisionValidate;
+  else error("PRECISION should be DOUBLE, MIXED or VALIDATE");
+
   vector<AtomNumber> ga_lista,gb_lista;
   parseAtomList("GROUPA",ga_lista);
   parseAtomList("GROUPB",gb_lista);
@@ -72,8 +88,14 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
   if(doneigh) {
     parse("NL_CUTOFF",nl_cut);
     if(nl_cut<=0.0) error("NL_CUTOFF should be explicitly specified and positive");
+    double nl_skin=0.0;
+    parse("NL_SKIN",nl_skin);
     parse("NL_STRIDE",nl_st);
-    if(nl_st<=0) error("NL_STRIDE should be explicitly specified and positive");
+    if(nl_skin>0.0) {
+      if(nl_st!=0) error("NL_STRIDE and NL_SKIN cannot be used together");
+      if(nl_skin>=nl_cut) error("NL_SKIN should be smaller than NL_CUTOFF");
+      verlet.setSkin(nl_skin);
+    } else if(nl_st<=0) error("NL_STRIDE should be explicitly specified and positive");
   }
 
   addValueWithDerivatives(); setNotPeriodic();
@@ -104,15 +126,20 @@ CoordinationBase::CoordinationBase(const ActionOptions&ao):
   if(dopair) log.printf("  with PAIR option\n");
   if(doneigh) {
     log.printf("  using neighbor lists with\n");
-    log.printf("  update every %d steps and cutoff %f\n",nl_st,nl_cut);
+    if(verlet.getSkin()>0.0) log.printf("  update when displacements exceed a skin %f and cutoff %f\n",verlet.getSkin(),nl_cut);
+    else log.printf("  update every %d steps and cutoff %f\n",nl_st,nl_cut);
   }
+  if(precision==precisionMixed) log.printf("  computing distances in single precision\n");
+  if(precision==precisionValidate) log.printf("  comparing distances computed in single and double precision\n");
 }
 
 CoordinationBase::~CoordinationBase() {
 // destructor required to delete forward declared class
+  if(verlet.getSkin()>0.0) log<<verlet;
 }
 
 void CoordinationBase::prepare() {
+  if(getExchangeStep()) verlet.invalidate();
   if(nl->getStride()>0) {
     if(firsttime || (getStep()%nl->getStride()==0)) {
       requestAtoms(nl->getFullAtomList());
@@ -136,10 +163,68 @@ void CoordinationBase::calculate()
   vector<Vector> deriv(getNumberOfAtoms());
 // deriv.resize(getPositions().size());
 
-  if(nl->getStride()>0 && invalidateList) {
+  if(verlet.getSkin()>0.0) {
+    if(verlet.needsUpdate(getPositions(),pbc?&getPbc():nullptr)) nl->update(getPositions());
+  } else if(nl->getStride()>0 && invalidateList) {
     nl->update(getPositions());
   }
 
+  pairSum(precision==precisionMixed,ncoord,deriv,virial);
+
+  if(precision==precisionValidate) {
+    double ncoord_mixed=0.;
+    Tensor virial_mixed;
+    vector<Vector> deriv_mixed(getNumberOfAtoms());
+    pairSum(true,ncoord_mixed,deriv_mixed,virial_mixed);
+    double dev_deriv=0.;
+    for(unsigned i=0; i<deriv.size(); ++i) for(unsigned k=0; k<3; k++)
+        dev_deriv=std::max(dev_deriv,std::fabs(deriv[i][k]-deriv_mixed[i][k]));
+    double dev_virial=0.;
+    for(unsigned i=0; i<3; i++) for(unsigned j=0; j<3; j++)
+        dev_virial=std::max(dev_virial,std::fabs(virial(i,j)-virial_mixed(i,j)));
+    log.printf("  step %lld: mixed precision deviation on value %e, derivatives %e, virial %e\n",
+               getStep(),std::fabs(ncoord-ncoord_mixed),dev_deriv,dev_virial);
+  }
+
+  for(unsigned i=0; i<deriv.size(); ++i) setAtomsDerivatives(i,deriv[i]);
+  setValue           (ncoord);
+  setBoxDerivatives  (virial);
+
+}
+
+void CoordinationBase::pairingBlock(unsigned n,const unsigned*i0,const unsigned*i1,const double*distance2,double*f,double*dfunc)const {
+  for(unsigned k=0; k<n; k++) f[k]=pairing(distance2[k],dfunc[k],i0[k],i1[k]);
+}
+
+void CoordinationBase::pairDistances(unsigned n,const unsigned*i0,const unsigned*i1,double*dx,double*dy,double*dz,double*d2)const {
+  const vector<Vector> & pos(getPositions());
+  for(unsigned k=0; k<n; k++) {
+    dx[k]=pos[i1[k]][0]-pos[i0[k]][0];
+    dy[k]=pos[i1[k]][1]-pos[i0[k]][1];
+    dz[k]=pos[i1[k]][2]-pos[i0[k]][2];
+  }
+  if(pbc && getPbc().isOrthorombic()) {
+// same operations as in Pbc::distance(), but on a block of pairs
+    const Tensor & box(getPbc().getBox());
+    const Tensor & invbox(getPbc().getInvBox());
+    const double bx=box(0,0),by=box(1,1),bz=box(2,2);
+    const double ix=invbox(0,0),iy=invbox(1,1),iz=invbox(2,2);
+    for(unsigned k=0; k<n; k++) {
+      dx[k]=Tools::pbc(dx[k]*ix)*bx;
+      dy[k]=Tools::pbc(dy[k]*iy)*by;
+      dz[k]=Tools::pbc(dz[k]*iz)*bz;
+    }
+  } else if(pbc) {
+    for(unsigned k=0; k<n; k++) {
+      Vector d=pbcDistance(pos[i0[k]],pos[i1[k]]);
+      dx[k]=d[0]; dy[k]=d[1]; dz[k]=d[2];
+    }
+  }
+  for(unsigned k=0; k<n; k++) d2[k]=dx[k]*dx[k]+dy[k]*dy[k]+dz[k]*dz[k];
+}
+
+void CoordinationBase::pairSum(bool mixed,double&ncoord,vector<Vector>&deriv,Tensor&virial) {
+
   unsigned stride=comm.Get_size();
   unsigned rank=comm.Get_rank();
   if(serial) {
@@ -157,48 +242,75 @@ void CoordinationBase::calculate()
   if(nt*stride*10>nn) nt=nn/stride/10;
   if(nt==0)nt=1;
 
-  #pragma omp parallel num_threads(nt)
-  {
-    std::vector<Vector> omp_deriv(getPositions().size());
-    Tensor omp_virial;
+  if(mixed) fpos.set(getPositions(),pbc?&getPbc():nullptr);
 
-    #pragma omp for reduction(+:ncoord) nowait
-    for(unsigned int i=rank; i<nn; i+=stride) {
+// pairs are processed in blocks of this size
+  const unsigned blocksize=64;
+  const unsigned nmine=(nn>rank?(nn-rank+stride-1)/stride:0);
+  const unsigned nblocks=(nmine+blocksize-1)/blocksize;
+  const unsigned natoms=getPositions().size();
 
-      Vector distance;
-      unsigned i0=nl->getClosePair(i).first;
-      unsigned i1=nl->getClosePair(i).second;
+// with more than one thread, each thread accumulates derivatives on its own copy,
+// and copies are then summed in parallel over atoms
+  vector<vector<Vector> > omp_deriv(nt>1?nt:0);
+  vector<Tensor> omp_virial(nt);
 
-      if(getAbsoluteIndex(i0)==getAbsoluteIndex(i1)) continue;
+  #pragma omp parallel num_threads(nt)
+  {
+    const unsigned tid=OpenMP::getThreadNum();
+    if(nt>1) omp_deriv[tid].assign(natoms,Vector(0.0,0.0,0.0));
+    std::vector<Vector> & myderiv(nt>1?omp_deriv[tid]:deriv);
+    Tensor & myvirial(nt>1?omp_virial[tid]:virial);
+
+    unsigned b0[blocksize],b1[blocksize];
+    double dx[blocksize],dy[blocksize],dz[blocksize],d2[blocksize];
+    double f[blocksize],dfunc[blocksize];
+    float fx[blocksize],fy[blocksize],fz[blocksize],fd2[blocksize];
+
+    #pragma omp for reduction(+:ncoord)
+    for(unsigned int b=0; b<nblocks; b++) {
+      unsigned n=0;
+      const unsigned iend=std::min(nn,rank+(b+1)*blocksize*stride);
+      for(unsigned int i=rank+b*blocksize*stride; i<iend; i+=stride) {
+        b0[n]=nl->getClosePair(i).first;
+        b1[n]=nl->getClosePair(i).second;
+        if(getAbsoluteIndex(b0[n])!=getAbsoluteIndex(b1[n])) n++;
+      }
 
-      if(pbc) {
-        distance=pbcDistance(getPosition(i0),getPosition(i1));
+      if(mixed) {
+        fpos.distances(n,b0,b1,fx,fy,fz,fd2);
+        for(unsigned k=0; k<n; k++) {
+          dx[k]=fx[k]; dy[k]=fy[k]; dz[k]=fz[k]; d2[k]=fd2[k];
+        }
       } else {
-        distance=delta(getPosition(i0),getPosition(i1));
+        pairDistances(n,b0,b1,dx,dy,dz,d2);
       }
 
-      double dfunc=0.;
-      ncoord += pairing(distance.modulo2(), dfunc,i0,i1);
+      pairingBlock(n,b0,b1,d2,f,dfunc);
 
-      Vector dd(dfunc*distance);
-      Tensor vv(dd,distance);
-      if(nt>1) {
-        omp_deriv[i0]-=dd;
-        omp_deriv[i1]+=dd;
-        omp_virial-=vv;
-      } else {
-        deriv[i0]-=dd;
-        deriv[i1]+=dd;
-        virial-=vv;
-      }
+      for(unsigned k=0; k<n; k++) {
+// pairs beyond the cutoff of the switching function do not contribute
+        if(f[k]==0.0 && dfunc[k]==0.0) continue;
+        ncoord += f[k];
 
+        Vector distance(dx[k],dy[k],dz[k]);
+        Vector dd(dfunc[k]*distance);
+        Tensor vv(dd,distance);
+        myderiv[b0[k]]-=dd;
+        myderiv[b1[k]]+=dd;
+        myvirial-=vv;
+      }
     }
-    #pragma omp critical
+
     if(nt>1) {
-      for(unsigned i=0; i<getPositions().size(); i++) deriv[i]+=omp_deriv[i];
-      virial+=omp_virial;
+// threads not taking part in the loop (e.g. in nested parallel regions) have empty copies
+      #pragma omp for
+      for(unsigned i=0; i<natoms; i++) {
+        for(unsigned t=0; t<nt; t++) if(!omp_deriv[t].empty()) deriv[i]+=omp_deriv[t][i];
+      }
     }
   }
+  if(nt>1) for(unsigned t=0; t<nt; t++) virial+=omp_virial[t];
 
   if(!serial) {
     comm.Sum(ncoord);
@@ -206,10 +318,6 @@ void CoordinationBase::calculate()
     comm.Sum(virial);
   }
 
-  for(unsigned i=0; i<deriv.size(); ++i) setAtomsDerivatives(i,deriv[i]);
-  setValue           (ncoord);
-  setBoxDerivatives  (virial);
-
 }
 }
 }
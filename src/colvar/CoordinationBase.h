@@ -22,6 +22,8 @@
 #ifndef __PLUMED_colvar_CoordinationBase_h
 #define __PLUMED_colvar_CoordinationBase_h
 #include "Colvar.h"
+#include "tools/FloatPositions.h"
+#include "tools/VerletSkin.h"
 #include <memory>
 
 namespace PLMD {
@@ -36,6 +38,16 @@ class CoordinationBase : public Colvar {
   std::unique_ptr<NeighborList> nl;
   bool invalidateList;
   bool firsttime;
+/// Used to update the neighbor list based on displacements
+  VerletSkin verlet;
+/// Precision used to compute distances
+  enum {precisionDouble,precisionMixed,precisionValidate} precision;
+/// Single precision copy of the positions, used in mixed precision
+  FloatPositions fpos;
+/// Sum the pairing function over all pairs, computing distances in double or single precision
+  void pairSum(bool mixed,double&ncoord,std::vector<Vector>&deriv,Tensor&virial);
+/// Compute distance vectors and their squared modulo for a block of pairs
+  void pairDistances(unsigned n,const unsigned*i0,const unsigned*i1,double*dx,double*dy,double*dz,double*d2)const;
 
 public:
   explicit CoordinationBase(const ActionOptions&);
@@ -44,6 +56,9 @@ public:
   virtual void calculate();
   virtual void prepare();
   virtual double pairing(double distance,double&dfunc,unsigned i,unsigned j)const=0;
+/// Compute the pairing function on a block of n pairs, given their squared distances.
+/// By default it calls pairing() on each pair, it can be overridden to avoid a virtual call per pair
+  virtual void pairingBlock(unsigned n,const unsigned*i0,const unsigned*i1,const double*distance2,double*f,double*dfunc)const;
   static void registerKeywords( Keywords& keys );
 };
 
@@ -28,6 +28,7 @@
 #include "core/PlumedMain.h"
 #include "core/SetupMolInfo.h"
 #include "tools/OpenMP.h"
+#include "tools/VerletSkin.h"
 #include <initializer_list>
 
 #define INV_PI_SQRT_PI 0.179587122
@@ -84,6 +85,8 @@ private:
   double delta_g_ref;
   unsigned stride;
   unsigned nl_update;
+  bool nl_skin;
+  VerletSkin verlet;
   vector<vector<unsigned> > nl;
   vector<vector<bool> > nlexpo;
   vector<vector<double> > parameter;
@@ -95,6 +98,7 @@ private:
 public:
   static void registerKeywords(Keywords& keys);
   explicit EEFSolv(const ActionOptions&);
+  ~EEFSolv();
   virtual void calculate();
 };
 
@@ -107,6 +111,7 @@ void EEFSolv::registerKeywords(Keywords& keys) {
   keys.add("atoms", "ATOMS", "The atoms to be included in the calculation, e.g. the whole protein.");
   keys.add("compulsory", "NL_BUFFER", "The buffer to the intrinsic cutoff used when calculating pairwise interactions.");
   keys.add("compulsory", "NL_STRIDE", "The frequency with which the neighbourlist is updated.");
+  keys.add("optional", "NL_SKIN", "Update the neighbourlist only when atoms have moved by more than this distance, instead of every NL_STRIDE steps. It cannot be larger than NL_BUFFER.");
   keys.addFlag("TEMP_CORRECTION", false, "Correct free energy of solvation constants for temperatures different from 298.15 K");
 }
 
@@ -116,7 +121,8 @@ EEFSolv::EEFSolv(const ActionOptions&ao):
   buffer(0.1),
   delta_g_ref(0.),
   stride(10),
-  nl_update(0)
+  nl_update(0),
+  nl_skin(false)
 {
   vector<AtomNumber> atoms;
   parseAtomList("ATOMS", atoms);
@@ -125,6 +131,12 @@ EEFSolv::EEFSolv(const ActionOptions&ao):
   parseFlag("TEMP_CORRECTION", tcorr);
   parse("NL_BUFFER", buffer);
   parse("NL_STRIDE", stride);
+  double skin = 0.0;
+  parse("NL_SKIN", skin);
+  if(skin > buffer) error("NL_SKIN cannot be larger than NL_BUFFER");
+  nl_skin = (skin > 0.0);
+// with a fixed stride the buffer is used to detect when the neighbourlist was not valid anymore
+  verlet.setSkin(nl_skin ? skin : buffer);
 
   bool nopbc = !pbc;
   parseFlag("NOPBC", nopbc);
@@ -132,6 +144,8 @@ EEFSolv::EEFSolv(const ActionOptions&ao):
 
   checkRead();
 
+  if(nl_skin) log.printf("  neighbourlist updated when atoms move by more than %f\n", skin);
+  else log.printf("  neighbourlist updated every %u steps\n", stride);
   log << "  Bibliography " << plumed.cite("Lazaridis T, Karplus M, Proteins Struct. Funct. Genet. 35, 133 (1999)"); log << "\n";
 
 
@@ -145,6 +159,10 @@ EEFSolv::EEFSolv(const ActionOptions&ao):
   requestAtoms(atoms);
 }
 
+EEFSolv::~EEFSolv() {
+  log << verlet;
+}
+
 void EEFSolv::update_neighb() {
   const double lower_c2 = 0.24 * 0.24; // this is the cut-off for bonded atoms
   const unsigned size = getNumberOfAtoms();
@@ -176,8 +194,15 @@ void EEFSolv::update_neighb() {
 
 void EEFSolv::calculate() {
   if(pbc) makeWhole();
-  if(getExchangeStep()) nl_update = 0;
-  if (nl_update == 0) {
+  if(getExchangeStep()) {
+    nl_update = 0;
+    verlet.invalidate();
+  }
+  const Pbc* verlet_pbc = (pbc ? &getPbc() : nullptr);
+  bool rebuild;
+  if(nl_skin) rebuild = verlet.needsUpdate(getPositions(), verlet_pbc);
+  else rebuild = verlet.scheduledUpdate(nl_update == 0, getPositions(), verlet_pbc);
+  if (rebuild) {
     update_neighb();
   }
 
@@ -47,6 +47,7 @@ ActionAtomistic::ActionAtomistic(const ActionOptions&ao):
   lockRequestAtoms(false),
   donotretrieve(false),
   donotforce(false),
+  globalforces(false),
   atoms(plumed.getAtoms())
 {
   atoms.add(this);
@@ -76,7 +77,7 @@ void ActionAtomistic::requestAtoms(const vector<AtomNumber> & a) {
     else unique.insert(indexes[i]);
   }
   updateUniqueLocal();
-  atoms.unique.clear();
+  atoms.resetUnique();
 }
 
 Vector ActionAtomistic::pbcDistance(const Vector &v1,const Vector &v2)const {
@@ -62,6 +62,7 @@ class ActionAtomistic :
 
   bool                  donotretrieve;
   bool                  donotforce;
+  bool                  globalforces; // set by allowToAccessGlobalForces()
 
 protected:
   Atoms&                atoms;
@@ -153,10 +154,12 @@ public:
 /// Make atoms whole, assuming they are in the proper order
   void makeWhole();
 /// Allow calls to modifyGlobalForce()
-  void allowToAccessGlobalForces() {atoms.zeroallforces=true;}
+  void allowToAccessGlobalForces() {atoms.zeroallforces=true; globalforces=true;}
 /// updates local unique atoms
   void updateUniqueLocal();
 public:
+/// Check if this action modifies the forces and positions of all the atoms
+  bool accessesGlobalForces() const {return globalforces;}
 
 // virtual functions:
 
@@ -41,6 +41,7 @@ class PlumedMain;
 
 Atoms::Atoms(PlumedMain&plumed):
   natoms(0),
+  uniqueReset(true),
   md_energy(0.0),
   energy(0.0),
   dataCanBeSet(false),
@@ -64,6 +65,7 @@ Atoms::Atoms(PlumedMain&plumed):
   kbT(0.0),
   asyncSent(false),
   atomsNeeded(false),
+  sharedBytes(0),
   ddStep(0)
 {
 }
@@ -145,15 +147,7 @@ void Atoms::share() {
   }
 
   if(!(int(gatindex.size())==natoms && shuffledAtoms==0)) {
-    for(unsigned i=0; i<actions.size(); i++) {
-      if(actions[i]->isActive()) {
-        if(!actions[i]->getUnique().empty()) {
-          atomsNeeded=true;
-          // unique are the local atoms
-          unique.insert(actions[i]->getUniqueLocal().begin(),actions[i]->getUniqueLocal().end());
-        }
-      }
-    }
+    updateUnique();
   } else {
     for(unsigned i=0; i<actions.size(); i++) {
       if(actions[i]->isActive()) {
@@ -168,19 +162,62 @@ void Atoms::share() {
   share(unique);
 }
 
+void Atoms::updateUnique() {
+  if(uniqueReset) {
+    unique.clear();
+    uniqueMask.assign(natoms,false);
+    uniqueActions.assign(actions.size(),false);
+  }
+  bool changed=uniqueReset;
+  uniqueReset=false;
+// the atoms of each action are only inserted once, so that this is a loop
+// over the actions unless the set of requested atoms changes
+  for(unsigned i=0; i<actions.size(); i++) {
+    if(actions[i]->isActive()) {
+      if(!actions[i]->getUnique().empty()) {
+        atomsNeeded=true;
+        if(uniqueActions[i]) continue;
+        uniqueActions[i]=true;
+        // unique are the local atoms
+        for(const auto & p : actions[i]->getUniqueLocal()) {
+          if(!uniqueMask[p.index()]) {
+            uniqueMask[p.index()]=true;
+            changed=true;
+          }
+        }
+      }
+    }
+  }
+  if(!changed) return;
+  unique.clear();
+  for(int i=0; i<natoms; i++) if(uniqueMask[i]) unique.push_back(AtomNumber::index(i));
+  uniq_index.clear();
+  uniq_index.reserve(unique.size());
+  if(shuffledAtoms>0) {
+    for(const auto & p : unique) uniq_index.push_back(g2l[p.index()]);
+  }
+}
+
 void Atoms::shareAll() {
   unique.clear();
   // keep in unique only those atoms that are local
   if(dd && shuffledAtoms>0) {
-    for(int i=0; i<natoms; i++) if(g2l[i]>=0) unique.insert(AtomNumber::index(i));
+    for(int i=0; i<natoms; i++) if(g2l[i]>=0) unique.push_back(AtomNumber::index(i));
   } else {
-    for(int i=0; i<natoms; i++) unique.insert(AtomNumber::index(i));
+    for(int i=0; i<natoms; i++) unique.push_back(AtomNumber::index(i));
+  }
+  uniq_index.clear();
+  if(shuffledAtoms>0) {
+    uniq_index.reserve(unique.size());
+    for(const auto & p : unique) uniq_index.push_back(g2l[p.index()]);
   }
+// at the next step unique is rebuilt, so that only the requested atoms are shared
+  resetUnique();
   atomsNeeded=true;
   share(unique);
 }
 
-void Atoms::share(const std::set<AtomNumber>& unique) {
+void Atoms::share(const std::vector<AtomNumber>& unique) {
   plumed_assert( positionsHaveBeenSet==3 && massesHaveBeenSet );
 
   virial.zero();
@@ -199,13 +236,10 @@ void Atoms::share(const std::set<AtomNumber>& unique) {
   if(int(gatindex.size())==natoms && shuffledAtoms==0) {
 // faster version, which retrieves all atoms
     mdatoms->getPositions(0,natoms,positions);
+    sharedBytes+=3ull*natoms*getRealPrecision();
   } else {
-    uniq_index.clear();
-    uniq_index.reserve(unique.size());
-    if(shuffledAtoms>0) {
-      for(const auto & p : unique) uniq_index.push_back(g2l[p.index()]);
-    }
     mdatoms->getPositions(unique,uniq_index,positions);
+    sharedBytes+=3ull*unique.size()*getRealPrecision();
   }
 
 
@@ -217,56 +251,60 @@ void Atoms::share(const std::set<AtomNumber>& unique) {
     charges.assign(charges.size(),NAN);
     mdatoms->getCharges(gatindex,charges);
     mdatoms->getMasses(gatindex,masses);
+    sharedBytes+=2ull*gatindex.size()*getRealPrecision();
   }
 
   if(dd && shuffledAtoms>0) {
     if(dd.async) {
       for(unsigned i=0; i<dd.mpi_request_positions.size(); i++) dd.mpi_request_positions[i].wait();
-      for(unsigned i=0; i<dd.mpi_request_index.size(); i++)     dd.mpi_request_index[i].wait();
     }
+// the index of each atom is stored (as a double) before its data
+    const int nsend=ndata+1;
     int count=0;
     for(const auto & p : unique) {
-      dd.indexToBeSent[count]=p.index();
-      dd.positionsToBeSent[ndata*count+0]=positions[p.index()][0];
-      dd.positionsToBeSent[ndata*count+1]=positions[p.index()][1];
-      dd.positionsToBeSent[ndata*count+2]=positions[p.index()][2];
+      double* buffer=&dd.positionsToBeSent[nsend*count];
+      buffer[0]=p.index();
+      buffer[1]=positions[p.index()][0];
+      buffer[2]=positions[p.index()][1];
+      buffer[3]=positions[p.index()][2];
       if(!massAndChargeOK) {
-        dd.positionsToBeSent[ndata*count+3]=masses[p.index()];
-        dd.positionsToBeSent[ndata*count+4]=charges[p.index()];
+        buffer[4]=masses[p.index()];
+        buffer[5]=charges[p.index()];
       }
       count++;
     }
+    sharedBytes+=count*nsend*sizeof(double)*(dd.async?dd.Get_size():1);
     if(dd.async) {
       asyncSent=true;
       dd.mpi_request_positions.resize(dd.Get_size());
-      dd.mpi_request_index.resize(dd.Get_size());
       for(int i=0; i<dd.Get_size(); i++) {
-        dd.mpi_request_index[i]=dd.Isend(&dd.indexToBeSent[0],count,i,666);
-        dd.mpi_request_positions[i]=dd.Isend(&dd.positionsToBeSent[0],ndata*count,i,667);
+        dd.mpi_request_positions[i]=dd.Isend(&dd.positionsToBeSent[0],nsend*count,i,667);
       }
     } else {
       const int n=(dd.Get_size());
-      vector<int> counts(n);
-      vector<int> displ(n);
-      vector<int> counts5(n);
-      vector<int> displ5(n);
-      dd.Allgather(count,counts);
-      displ[0]=0;
-      for(int i=1; i<n; ++i) displ[i]=displ[i-1]+counts[i-1];
-      for(int i=0; i<n; ++i) counts5[i]=counts[i]*ndata;
-      for(int i=0; i<n; ++i) displ5[i]=displ[i]*ndata;
-      dd.Allgatherv(&dd.indexToBeSent[0],count,&dd.indexToBeReceived[0],&counts[0],&displ[0]);
-      dd.Allgatherv(&dd.positionsToBeSent[0],ndata*count,&dd.positionsToBeReceived[0],&counts5[0],&displ5[0]);
-      int tot=displ[n-1]+counts[n-1];
-      for(int i=0; i<tot; i++) {
-        positions[dd.indexToBeReceived[i]][0]=dd.positionsToBeReceived[ndata*i+0];
-        positions[dd.indexToBeReceived[i]][1]=dd.positionsToBeReceived[ndata*i+1];
-        positions[dd.indexToBeReceived[i]][2]=dd.positionsToBeReceived[ndata*i+2];
-        if(!massAndChargeOK) {
-          masses[dd.indexToBeReceived[i]]      =dd.positionsToBeReceived[ndata*i+3];
-          charges[dd.indexToBeReceived[i]]     =dd.positionsToBeReceived[ndata*i+4];
-        }
-      }
+      dd.counts.resize(n);
+      dd.displ.resize(n);
+      dd.Allgather(count,dd.counts);
+      for(int i=0; i<n; ++i) dd.counts[i]*=nsend;
+      dd.displ[0]=0;
+      for(int i=1; i<n; ++i) dd.displ[i]=dd.displ[i-1]+dd.counts[i-1];
+      dd.Allgatherv(&dd.positionsToBeSent[0],nsend*count,&dd.positionsToBeReceived[0],&dd.counts[0],&dd.displ[0]);
+      unpackSharedAtoms((dd.displ[n-1]+dd.counts[n-1])/nsend,ndata);
+    }
+  }
+}
+
+void Atoms::unpackSharedAtoms(int n,int ndata) {
+  const int nsend=ndata+1;
+  for(int i=0; i<n; i++) {
+    const double* buffer=&dd.positionsToBeReceived[nsend*i];
+    const unsigned j=static_cast<unsigned>(buffer[0]);
+    positions[j][0]=buffer[1];
+    positions[j][1]=buffer[2];
+    positions[j][2]=buffer[3];
+    if(ndata>3) {
+      masses[j]=buffer[4];
+      charges[j]=buffer[5];
     }
   }
 }
@@ -288,22 +326,13 @@ void Atoms::wait() {
 // receive toBeReceived
     if(asyncSent) {
       Communicator::Status status;
+      const int nsend=ndata+1;
       int count=0;
       for(int i=0; i<dd.Get_size(); i++) {
-        dd.Recv(&dd.indexToBeReceived[count],dd.indexToBeReceived.size()-count,i,666,status);
-        int c=status.Get_count<int>();
-        dd.Recv(&dd.positionsToBeReceived[ndata*count],dd.positionsToBeReceived.size()-ndata*count,i,667);
-        count+=c;
-      }
-      for(int i=0; i<count; i++) {
-        positions[dd.indexToBeReceived[i]][0]=dd.positionsToBeReceived[ndata*i+0];
-        positions[dd.indexToBeReceived[i]][1]=dd.positionsToBeReceived[ndata*i+1];
-        positions[dd.indexToBeReceived[i]][2]=dd.positionsToBeReceived[ndata*i+2];
-        if(!massAndChargeOK) {
-          masses[dd.indexToBeReceived[i]]      =dd.positionsToBeReceived[ndata*i+3];
-          charges[dd.indexToBeReceived[i]]     =dd.positionsToBeReceived[ndata*i+4];
-        }
+        dd.Recv(&dd.positionsToBeReceived[nsend*count],dd.positionsToBeReceived.size()-nsend*count,i,667,status);
+        count+=status.Get_count<double>()/nsend;
       }
+      unpackSharedAtoms(count,ndata);
       asyncSent=false;
     }
     if(collectEnergy) dd.Sum(energy);
@@ -342,12 +371,14 @@ void Atoms::setNatoms(int n) {
 
 void Atoms::add(ActionAtomistic*a) {
   actions.push_back(a);
+  resetUnique();
 }
 
 void Atoms::remove(ActionAtomistic*a) {
   auto f=find(actions.begin(),actions.end(),a);
   plumed_massert(f!=actions.end(),"cannot remove an action registered to atoms");
   actions.erase(f);
+  resetUnique();
 }
 
 
@@ -372,10 +403,9 @@ void Atoms::setAtomsNlocal(int n) {
 // we make sure they are non-zero-sized so as to
 // avoid errors when doing boundary check
     if(n==0) n++;
-    dd.positionsToBeSent.resize(n*5,0.0);
-    dd.positionsToBeReceived.resize(natoms*5,0.0);
-    dd.indexToBeSent.resize(n,0);
-    dd.indexToBeReceived.resize(natoms,0);
+// up to 6 values per atom: index, positions, mass and charge
+    dd.positionsToBeSent.resize(n*6,0.0);
+    dd.positionsToBeReceived.resize(natoms*6,0.0);
   }
 }
 
@@ -405,7 +435,7 @@ void Atoms::setAtomsGatindex(int*g,bool fortran) {
     // keep in unique only those atoms that are local
     actions[i]->updateUniqueLocal();
   }
-  unique.clear();
+  resetUnique();
 }
 
 void Atoms::setAtomsContiguous(int start) {
@@ -418,7 +448,7 @@ void Atoms::setAtomsContiguous(int start) {
     // keep in unique only those atoms that are local
     actions[i]->updateUniqueLocal();
   }
-  unique.clear();
+  resetUnique();
 }
 
 void Atoms::setRealPrecision(int p) {
@@ -463,22 +493,23 @@ void Atoms::createFullList(int*n) {
     fullList.resize(natoms);
     for(unsigned i=0; i<natoms; i++) fullList[i]=i;
   } else {
-// We update here the unique list defined at Atoms::unique.
+// We reset here the unique list defined at Atoms::unique, so that it only contains
+// the atoms requested by the currently active actions.
 // This is not very clear, and probably should be coded differently.
 // Hopefully this fix the longstanding issue with NAMD.
-    unique.clear();
+    resetUnique();
+    std::set<AtomNumber> requested;
     for(unsigned i=0; i<actions.size(); i++) {
       if(actions[i]->isActive()) {
         if(!actions[i]->getUnique().empty()) {
           atomsNeeded=true;
-          // unique are the local atoms
-          unique.insert(actions[i]->getUnique().begin(),actions[i]->getUnique().end());
+          requested.insert(actions[i]->getUnique().begin(),actions[i]->getUnique().end());
         }
       }
     }
     fullList.resize(0);
-    fullList.reserve(unique.size());
-    for(const auto & p : unique) fullList.push_back(p.index());
+    fullList.reserve(requested.size());
+    for(const auto & p : requested) fullList.push_back(p.index());
     *n=fullList.size();
   }
 }
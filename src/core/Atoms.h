@@ -49,8 +49,17 @@ class Atoms
   friend class ActionAtomistic;
   friend class ActionWithVirtualAtom;
   int natoms;
-  std::set<AtomNumber> unique;
+/// Sorted list of the local atoms requested by the actions that have been active
+/// since the last time the requests or the domain decomposition changed.
+  std::vector<AtomNumber> unique;
+/// Position of the atoms in unique in the arrays passed from the MD engine
   std::vector<unsigned> uniq_index;
+/// uniqueMask[i] is true if atom i is in unique
+  std::vector<bool> uniqueMask;
+/// uniqueActions[i] is true if the atoms of actions[i] have been included in unique
+  std::vector<bool> uniqueActions;
+/// unique should be rebuilt from scratch
+  bool uniqueReset;
 /// Map global indexes to local indexes
 /// E.g. g2l[i] is the position of atom i in the array passed from the MD engine.
 /// Called "global to local" since originally it was used to map global indexes to local
@@ -115,6 +124,9 @@ class Atoms
   bool asyncSent;
   bool atomsNeeded;
 
+/// Number of bytes copied from the MD code and sent to other processes in share()
+  unsigned long long sharedBytes;
+
   class DomainDecomposition:
     public Communicator
   {
@@ -123,12 +135,14 @@ class Atoms
     bool async;
 
     std::vector<Communicator::Request> mpi_request_positions;
-    std::vector<Communicator::Request> mpi_request_index;
 
+/// Each atom is sent as its index followed by its positions (and masses and charges),
+/// so that a single message is needed
     std::vector<double> positionsToBeSent;
     std::vector<double> positionsToBeReceived;
-    std::vector<int>    indexToBeSent;
-    std::vector<int>    indexToBeReceived;
+/// Number of values received from each process and offsets
+    std::vector<int> counts;
+    std::vector<int> displ;
     operator bool() const {return on;}
     DomainDecomposition():
       on(false), async(false)
@@ -139,7 +153,13 @@ class Atoms
   DomainDecomposition dd;
   long int ddStep;  //last step in which dd happened
 
-  void share(const std::set<AtomNumber>&);
+  void share(const std::vector<AtomNumber>&);
+/// Add to unique the atoms of the active actions that are not yet included
+  void updateUnique();
+/// Mark unique for rebuilding, to be called when requests or local atoms change
+  void resetUnique() {uniqueReset=true;}
+/// Copy n atoms received from other processes, each stored as index followed by ndata values
+  void unpackSharedAtoms(int n,int ndata);
 
 public:
 
@@ -166,6 +186,8 @@ public:
   const int & getNatoms()const;
 
   const long int& getDdStep()const;
+/// Total number of bytes moved by share() so far
+  unsigned long long getSharedBytes()const {return sharedBytes;}
   const std::vector<int>& getGatindex()const;
   const Pbc& getPbc()const;
   void getLocalMasses(std::vector<double>&);
@@ -41,9 +41,11 @@
 #include "tools/Tools.h"
 #include "tools/Stopwatch.h"
 #include "DataFetchingObject.h"
+#include "Profiler.h"
 #include <cstdlib>
 #include <cstring>
 #include <set>
+#include <exception>
 #include <unordered_map>
 
 using namespace std;
@@ -79,6 +81,7 @@ PlumedMain::PlumedMain():
   doCheckPoint(false),
   stopFlag(NULL),
   stopNow(false),
+  parallelActions(false),
   novirial(false),
   detailedTimers(false)
 {
@@ -495,6 +498,17 @@ void PlumedMain::init() {
   log.printf("Running over %d %s\n",comm.Get_size(),(comm.Get_size()>1?"nodes":"node"));
   log<<"Number of threads: "<<OpenMP::getNumThreads()<<"\n";
   log<<"Cache line size: "<<OpenMP::getCachelineSize()<<"\n";
+  if(std::getenv("PLUMED_PARALLEL_ACTIONS")) {
+    std::string s(std::getenv("PLUMED_PARALLEL_ACTIONS"));
+    if(s=="yes") parallelActions=true;
+    else if(s=="no") parallelActions=false;
+    else plumed_merror("PLUMED_PARALLEL_ACTIONS variable is set to " + s + "; should be yes or no");
+  }
+  if(parallelActions) {
+    log<<"Independent actions are calculated concurrently";
+    if(OpenMP::getNumThreads()<2 || comm.Get_size()>1) log<<" (inactive: it requires more than one thread and a single MPI process)";
+    log<<"\n";
+  }
   log.printf("Number of atoms: %d\n",atoms.getNatoms());
   if(grex) log.printf("GROMACS-like replica exchange is on\n");
   log.printf("File suffix: %s\n",getSuffix().c_str());
@@ -600,6 +614,8 @@ void PlumedMain::prepareDependencies() {
 // Stopwatch is stopped when sw goes out of scope
   auto sw=stopwatch.startStop("1 Prepare dependencies");
 
+  if(profiler) profiler->startStep(step,actionSet);
+
 // activate all the actions which are on step
 // activation is recursive and enables also the dependencies
 // before doing that, the prepare() method is called to see if there is some
@@ -634,7 +650,10 @@ void PlumedMain::shareData() {
   if(!active)return;
 // Stopwatch is stopped when sw goes out of scope
   auto sw=stopwatch.startStop("2 Sharing data");
+  Profiler::Sample start;
+  if(profiler) start=profiler->now();
   if(atoms.getNatoms()>0) atoms.share();
+  if(profiler) profiler->record(NULL,Profiler::Phase::share,start);
 }
 
 void PlumedMain::performCalcNoUpdate() {
@@ -655,7 +674,10 @@ void PlumedMain::waitData() {
   if(!active)return;
 // Stopwatch is stopped when sw goes out of scope
   auto sw=stopwatch.startStop("3 Waiting for data");
+  Profiler::Sample start;
+  if(profiler) start=profiler->now();
   if(atoms.getNatoms()>0) atoms.wait();
+  if(profiler) profiler->record(NULL,Profiler::Phase::wait,start);
 }
 
 void PlumedMain::justCalculate() {
@@ -665,6 +687,29 @@ void PlumedMain::justCalculate() {
   bias=0.0;
   work=0.0;
 
+  if(useParallelActions()) {
+    buildActionBatches();
+    const unsigned nt=OpenMP::getNumThreads();
+    for(const auto & batch : forwardBatches) {
+      const unsigned n=batch.size();
+      std::vector<std::exception_ptr> errors(n);
+// actions in the same batch do not depend on each other
+      #pragma omp parallel for num_threads(nt) schedule(dynamic,1) if(n>1)
+      for(unsigned i=0; i<n; i++) {
+        if(!batch[i]->isActive()) continue;
+        try {
+          calculateAction(batch[i]);
+        } catch(...) {
+          errors[i]=std::current_exception();
+        }
+      }
+      for(unsigned i=0; i<n; i++) if(errors[i]) std::rethrow_exception(errors[i]);
+// the results are collected in the same order as in the serial loop
+      for(unsigned i=0; i<n; i++) if(batch[i]->isActive()) finishCalculateAction(batch[i]);
+    }
+    return;
+  }
+
   int iaction=0;
 // calculate the active actions in order (assuming *backward* dependence)
   for(const auto & pp : actionSet) {
@@ -682,29 +727,90 @@ void PlumedMain::justCalculate() {
         for(int i=0; i<pad; i++) actionNumberLabel=" "+actionNumberLabel;
         sw=stopwatch.startStop("4A "+actionNumberLabel+" "+p->getLabel());
       }
-      ActionWithValue*av=dynamic_cast<ActionWithValue*>(p);
-      ActionAtomistic*aa=dynamic_cast<ActionAtomistic*>(p);
-      {
-        if(av) av->clearInputForces();
-        if(av) av->clearDerivatives();
-      }
-      {
-        if(aa) aa->clearOutputForces();
-        if(aa) if(aa->isActive()) aa->retrieveAtoms();
-      }
-      if(p->checkNumericalDerivatives()) p->calculateNumericalDerivatives();
-      else p->calculate();
-      // This retrieves components called bias
-      if(av) bias+=av->getOutputQuantity("bias");
-      if(av) work+=av->getOutputQuantity("work");
-      if(av)av->setGradientsIfNeeded();
-      ActionWithVirtualAtom*avv=dynamic_cast<ActionWithVirtualAtom*>(p);
-      if(avv)avv->setGradientsIfNeeded();
+      calculateAction(p);
+      finishCalculateAction(p);
     }
     iaction++;
   }
 }
 
+void PlumedMain::calculateAction(Action* p) {
+  Profiler::Sample start;
+  if(profiler) start=profiler->now();
+  ActionWithValue*av=dynamic_cast<ActionWithValue*>(p);
+  ActionAtomistic*aa=dynamic_cast<ActionAtomistic*>(p);
+  {
+    if(av) av->clearInputForces();
+    if(av) av->clearDerivatives();
+  }
+  {
+    if(aa) aa->clearOutputForces();
+    if(aa) if(aa->isActive()) aa->retrieveAtoms();
+  }
+  if(p->checkNumericalDerivatives()) p->calculateNumericalDerivatives();
+  else p->calculate();
+  if(profiler) profiler->record(p,Profiler::Phase::calculate,start);
+}
+
+void PlumedMain::finishCalculateAction(Action* p) {
+  ActionWithValue*av=dynamic_cast<ActionWithValue*>(p);
+  // This retrieves components called bias
+  if(av) bias+=av->getOutputQuantity("bias");
+  if(av) work+=av->getOutputQuantity("work");
+  if(av)av->setGradientsIfNeeded();
+  ActionWithVirtualAtom*avv=dynamic_cast<ActionWithVirtualAtom*>(p);
+  if(avv)avv->setGradientsIfNeeded();
+}
+
+bool PlumedMain::useParallelActions() const {
+// actions might use MPI collectives and stopwatches are not thread safe
+  return parallelActions && OpenMP::getNumThreads()>1 && comm.Get_size()==1 && !detailedTimers;
+}
+
+// Dependencies can change during the simulation (e.g. with neighbor lists),
+// so batches are rebuilt at every step. This is linear in the number of dependencies.
+void PlumedMain::buildActionBatches() {
+  forwardBatches.clear();
+  backwardBatches.clear();
+// actions modifying the global positions or forces (e.g. FIT_TO_TEMPLATE or WHOLEMOLECULES)
+// affect all the following actions, and actions calculating numerical derivatives might
+// modify their arguments, so they run alone
+  auto runsAlone=[](Action* p) {
+    if(p->checkNumericalDerivatives()) return true;
+    ActionAtomistic* aa=dynamic_cast<ActionAtomistic*>(p);
+    if(aa && aa->accessesGlobalForces()) return true;
+    return aa && !dynamic_cast<ActionWithValue*>(p) && !dynamic_cast<ActionWithVirtualAtom*>(p);
+  };
+// forward: an action is added to the current batch if it does not depend on any action in it
+  std::set<Action*> members;
+  for(const auto & pp : actionSet) {
+    Action* p(pp.get());
+    bool join=!forwardBatches.empty() && !runsAlone(p) && !runsAlone(forwardBatches.back()[0]);
+    if(join) for(const auto & d : p->getDependencies()) if(members.count(d)) {join=false; break;}
+    if(!join) {
+      forwardBatches.push_back(std::vector<Action*>());
+      members.clear();
+    }
+    forwardBatches.back().push_back(p);
+    members.insert(p);
+  }
+// backward: apply() writes forces on the dependencies, so actions in the same batch
+// must be independent and must not share any dependency.
+// ActionAtomistic::applyForces is then called in the same order as in the serial loop
+  std::set<Action*> targets;
+  for(auto pp=actionSet.rbegin(); pp!=actionSet.rend(); ++pp) {
+    Action* p(pp->get());
+    bool join=!backwardBatches.empty() && !targets.count(p) && !runsAlone(p) && !runsAlone(backwardBatches.back()[0]);
+    if(join) for(const auto & d : p->getDependencies()) if(targets.count(d)) {join=false; break;}
+    if(!join) {
+      backwardBatches.push_back(std::vector<Action*>());
+      targets.clear();
+    }
+    backwardBatches.back().push_back(p);
+    for(const auto & d : p->getDependencies()) targets.insert(d);
+  }
+}
+
 void PlumedMain::justApply() {
   backwardPropagate();
   update();
@@ -715,31 +821,38 @@ void PlumedMain::backwardPropagate() {
   int iaction=0;
 // Stopwatch is stopped when sw goes out of scope
   auto sw=stopwatch.startStop("5 Applying (backward loop)");
+  if(useParallelActions()) {
+    applyActionBatches();
+  } else {
 // apply them in reverse order
-  for(auto pp=actionSet.rbegin(); pp!=actionSet.rend(); ++pp) {
-    const auto & p(pp->get());
-    if(p->isActive()) {
+    for(auto pp=actionSet.rbegin(); pp!=actionSet.rend(); ++pp) {
+      const auto & p(pp->get());
+      if(p->isActive()) {
 
 // Stopwatch is stopped when sw goes out of scope.
 // We explicitly declare a Stopwatch::Handler here to allow for conditional initialization.
-      Stopwatch::Handler sw;
-      if(detailedTimers) {
-        std::string actionNumberLabel;
-        Tools::convert(iaction,actionNumberLabel);
-        const unsigned m=actionSet.size();
-        unsigned k=0; unsigned n=1; while(n<m) { n*=10; k++; }
-        const int pad=k-actionNumberLabel.length();
-        for(int i=0; i<pad; i++) actionNumberLabel=" "+actionNumberLabel;
-        sw=stopwatch.startStop("5A "+actionNumberLabel+" "+p->getLabel());
-      }
+        Stopwatch::Handler sw;
+        if(detailedTimers) {
+          std::string actionNumberLabel;
+          Tools::convert(iaction,actionNumberLabel);
+          const unsigned m=actionSet.size();
+          unsigned k=0; unsigned n=1; while(n<m) { n*=10; k++; }
+          const int pad=k-actionNumberLabel.length();
+          for(int i=0; i<pad; i++) actionNumberLabel=" "+actionNumberLabel;
+          sw=stopwatch.startStop("5A "+actionNumberLabel+" "+p->getLabel());
+        }
 
-      p->apply();
-      ActionAtomistic*a=dynamic_cast<ActionAtomistic*>(p);
+        Profiler::Sample start;
+        if(profiler) start=profiler->now();
+        p->apply();
+        ActionAtomistic*a=dynamic_cast<ActionAtomistic*>(p);
 // still ActionAtomistic has a special treatment, since they may need to add forces on atoms
-      if(a) a->applyForces();
+        if(a) a->applyForces();
+        if(profiler) profiler->record(p,Profiler::Phase::apply,start);
 
+      }
+      iaction++;
     }
-    iaction++;
   }
 
 // Stopwatch is stopped when sw goes out of scope.
@@ -747,7 +860,41 @@ void PlumedMain::backwardPropagate() {
   Stopwatch::Handler sw1;
   if(detailedTimers) sw1=stopwatch.startStop("5B Update forces");
 // this is updating the MD copy of the forces
+  Profiler::Sample start;
+  if(profiler) start=profiler->now();
   if(atoms.getNatoms()>0) atoms.updateForces();
+  if(profiler) profiler->record(NULL,Profiler::Phase::forces,start);
+}
+
+void PlumedMain::applyActionBatches() {
+  const unsigned nt=OpenMP::getNumThreads();
+  for(const auto & batch : backwardBatches) {
+    const unsigned n=batch.size();
+    std::vector<std::exception_ptr> errors(n);
+    #pragma omp parallel for num_threads(nt) schedule(dynamic,1) if(n>1)
+    for(unsigned i=0; i<n; i++) {
+      if(!batch[i]->isActive()) continue;
+      try {
+        Profiler::Sample start;
+        if(profiler) start=profiler->now();
+        batch[i]->apply();
+        if(profiler) profiler->record(batch[i],Profiler::Phase::apply,start);
+      } catch(...) {
+        errors[i]=std::current_exception();
+      }
+    }
+    for(unsigned i=0; i<n; i++) if(errors[i]) std::rethrow_exception(errors[i]);
+    for(unsigned i=0; i<n; i++) {
+      ActionAtomistic*a=dynamic_cast<ActionAtomistic*>(batch[i]);
+      if(a && a->isActive()) {
+        Profiler::Sample start;
+        if(profiler) start=profiler->now();
+        a->applyForces();
+// same call as apply() above
+        if(profiler) profiler->record(a,Profiler::Phase::apply,start,false);
+      }
+    }
+  }
 }
 
 void PlumedMain::update() {
@@ -760,7 +907,12 @@ void PlumedMain::update() {
   updateFlags.push(true);
   for(const auto & p : actionSet) {
     p->beforeUpdate();
-    if(p->isActive() && p->checkUpdate() && updateFlagsTop()) p->update();
+    if(p->isActive() && p->checkUpdate() && updateFlagsTop()) {
+      Profiler::Sample start;
+      if(profiler) start=profiler->now();
+      p->update();
+      if(profiler) profiler->record(p.get(),Profiler::Phase::update,start);
+    }
   }
   while(!updateFlags.empty()) updateFlags.pop();
   if(!updateFlags.empty()) plumed_merror("non matching changes in the update flags");
@@ -770,6 +922,8 @@ void PlumedMain::update() {
     else plumed_merror("your md code cannot handle plumed stop events - add a call to plumed.comm(stopFlag,stopCondition)");
   }
 
+  if(profiler) profiler->endStep();
+
 // flush by default every 10000 steps
 // hopefully will not affect performance
 // also if receive checkpointing signal
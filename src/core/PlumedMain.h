@@ -52,6 +52,7 @@ namespace PLMD {
 
 
 
+class Action;
 class ActionAtomistic;
 class ActionPilot;
 class Log;
@@ -64,6 +65,7 @@ class Citations;
 class ExchangePatterns;
 class FileBase;
 class DataFetchingObject;
+class Profiler;
 
 /**
 Main plumed object.
@@ -186,6 +188,20 @@ private:
 /// Store information used in class \ref generic::UpdateIf
   std::stack<bool> updateFlags;
 
+/// Run independent actions concurrently (set with PLUMED_PARALLEL_ACTIONS=yes)
+  bool parallelActions;
+/// Groups of consecutive independent actions for the forward and the backward loop
+  std::vector<std::vector<Action*> > forwardBatches, backwardBatches;
+/// Build forwardBatches and backwardBatches from the dependencies of the actions
+  void buildActionBatches();
+/// Check if the actions can be run concurrently in this step
+  bool useParallelActions() const;
+/// Forward loop operations for a single action
+  void calculateAction(Action*);
+  void finishCalculateAction(Action*);
+/// Backward loop running the batches of independent actions concurrently
+  void applyActionBatches();
+
 public:
 /// Flag to switch off virial calculation (for debug and MD codes with no barostat)
   bool novirial;
@@ -193,6 +209,9 @@ public:
 /// Flag to switch on detailed timers
   bool detailedTimers;
 
+/// Per-action timings and counters, only allocated when profiling is requested with DEBUG PROFILE
+  std::unique_ptr<Profiler> profiler;
+
 /// Generic map string -> double
 /// intended to pass information across Actions
   std::map<std::string,double> passMap;
@@ -0,0 +1,251 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2011-2018 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "Profiler.h"
+#include "PlumedMain.h"
+#include "ActionSet.h"
+#include "Atoms.h"
+#include "tools/Communicator.h"
+#include "tools/OpenMP.h"
+#include "tools/Exception.h"
+#include <cstdio>
+#include <ctime>
+
+using namespace std;
+
+namespace PLMD {
+
+namespace {
+
+long long nanoseconds(std::chrono::steady_clock::duration d) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+}
+
+long long nanoseconds(std::clock_t c) {
+  return (long long)(1e9*c/CLOCKS_PER_SEC);
+}
+
+/// CPU time of the process, or of the calling thread if thread is true and the system allows it
+long long cpuTime(bool thread) {
+#ifdef CLOCK_THREAD_CPUTIME_ID
+  if(thread) {
+    struct timespec ts;
+    if(clock_gettime(CLOCK_THREAD_CPUTIME_ID,&ts)==0) return 1000000000LL*ts.tv_sec+ts.tv_nsec;
+  }
+#endif
+  return nanoseconds(std::clock());
+}
+
+}
+
+Profiler::Slot::Slot(const std::string&label):
+  label(label)
+{
+  for(unsigned i=0; i<nphases; i++) {
+    calls[i]=0;
+    wall[i]=0;
+    cpu[i]=0;
+  }
+}
+
+Profiler::Profiler(PlumedMain&plumed,const std::string&file,const std::string&format,unsigned stride):
+  plumed(plumed),
+  output(file.length()>0),
+  trace(false),
+  stride(stride),
+  step(0),
+  sampling(false),
+  pending(false),
+  firstEvent(true),
+  origin(std::chrono::steady_clock::now()),
+  slots(1,Slot(""))
+{
+  if(format=="TRACE") trace=true;
+  else if(format!="JSONL") plumed_merror("PROFILE_FORMAT should be either JSONL or TRACE");
+  plumed_massert(stride>0,"PROFILE_STRIDE should be positive");
+  Communicator::enableTiming(true);
+  mpiTime0=Communicator::getCollectiveTime();
+  mpiCalls0=Communicator::getCollectiveCalls();
+  sharedBytes0=plumed.getAtoms().getSharedBytes();
+  if(output) {
+    ofile.link(plumed);
+    ofile.open(file);
+    if(trace) ofile.printf("[\n");
+  }
+}
+
+Profiler::~Profiler() {
+  if(output && !trace && pending) writeCounters();
+  if(output && trace) ofile.printf("\n]\n");
+  Communicator::enableTiming(false);
+}
+
+const char* Profiler::phaseName(unsigned i) {
+  static const char* names[nphases]= {"calculate","apply","update","share","wait","forces"};
+  return names[i];
+}
+
+std::string Profiler::escape(const std::string&s) {
+  std::string r;
+  for(const auto c : s) {
+    if(c=='"' || c=='\\') r.push_back('\\');
+    r.push_back(c);
+  }
+  return r;
+}
+
+void Profiler::startStep(long int step,const ActionSet&actionSet) {
+  this->step=step;
+  sampling=trace && step%stride==0;
+  pending=true;
+// actions can only be added, so new slots are appended at the end
+  for(unsigned i=slots.size()-1; i<actionSet.size(); i++) {
+    slots.push_back(Slot(actionSet[i]->getLabel()));
+    slotIndex[actionSet[i].get()]=i+1;
+  }
+  for(auto & s : slots) s.intervals.clear();
+}
+
+Profiler::Sample Profiler::now() {
+  Sample s;
+  s.wall=std::chrono::steady_clock::now();
+  s.threadCpu=OpenMP::inParallel();
+  s.cpu=cpuTime(s.threadCpu);
+  return s;
+}
+
+void Profiler::record(const Action*action,Phase phase,const Sample&start,bool newCall) {
+  Sample end;
+  end.wall=std::chrono::steady_clock::now();
+  end.cpu=cpuTime(start.threadCpu);
+  unsigned i=0;
+  if(action) {
+    const auto it=slotIndex.find(action);
+// action created after the beginning of the step
+    if(it==slotIndex.end()) return;
+    i=it->second;
+  }
+  Slot & s(slots[i]);
+  const unsigned p=static_cast<unsigned>(phase);
+  const long long wall=nanoseconds(end.wall-start.wall);
+  const long long cpu=end.cpu-start.cpu;
+  if(newCall) s.calls[p]++;
+  s.wall[p]+=wall;
+  s.cpu[p]+=cpu;
+  if(sampling) {
+    Interval interval;
+    interval.phase=phase;
+    interval.thread=OpenMP::getThreadNum();
+    interval.start=nanoseconds(start.wall-origin);
+    interval.wall=wall;
+    interval.cpu=cpu;
+    s.intervals.push_back(interval);
+  }
+}
+
+void Profiler::endStep() {
+  if(!output || step%stride!=0) return;
+  if(trace) writeTrace();
+  else writeCounters();
+  pending=false;
+  ofile.flush();
+}
+
+void Profiler::reset() {
+  for(auto & s : slots) {
+    for(unsigned p=0; p<nphases; p++) {
+      s.calls[p]=0;
+      s.wall[p]=0;
+      s.cpu[p]=0;
+    }
+  }
+  mpiTime0=Communicator::getCollectiveTime();
+  mpiCalls0=Communicator::getCollectiveCalls();
+  sharedBytes0=plumed.getAtoms().getSharedBytes();
+}
+
+std::vector<Profiler::Total> Profiler::getTotals()const {
+  std::vector<Total> totals;
+  for(const auto & s : slots) {
+    for(unsigned p=0; p<nphases; p++) if(s.calls[p]>0) {
+        Total t;
+        t.label=s.label;
+        t.phase=phaseName(p);
+        t.calls=s.calls[p];
+        t.wall=1e-9*s.wall[p];
+        t.cpu=1e-9*s.cpu[p];
+        totals.push_back(t);
+      }
+  }
+  return totals;
+}
+
+double Profiler::getCollectiveTime()const {
+  return Communicator::getCollectiveTime()-mpiTime0;
+}
+
+unsigned long long Profiler::getSharedBytes()const {
+  return plumed.getAtoms().getSharedBytes()-sharedBytes0;
+}
+
+void Profiler::writeCounters() {
+  for(unsigned i=0; i<slots.size(); i++) {
+    std::string action;
+    if(i>0) action="\"action\":\""+escape(slots[i].label)+"\",";
+    for(unsigned p=0; p<nphases; p++) if(slots[i].calls[p]>0) {
+        ofile.printf("{\"step\":%ld,%s\"phase\":\"%s\",\"calls\":%lu,\"wall\":%.9f,\"cpu\":%.9f}\n",
+                     step,action.c_str(),phaseName(p),slots[i].calls[p],1e-9*slots[i].wall[p],1e-9*slots[i].cpu[p]);
+      }
+  }
+  ofile.printf("{\"step\":%ld,\"mpi_calls\":%lu,\"mpi_time\":%.9f,\"shared_bytes\":%llu}\n",
+               step,Communicator::getCollectiveCalls()-mpiCalls0,getCollectiveTime(),getSharedBytes());
+}
+
+void Profiler::writeEvent(const std::string&event) {
+  if(!firstEvent) ofile.printf(",\n");
+  firstEvent=false;
+  ofile.printf("%s",event.c_str());
+}
+
+void Profiler::writeTrace() {
+  const int pid=plumed.multi_sim_comm.Get_rank();
+  char buffer[1000];
+  for(unsigned i=0; i<slots.size(); i++) {
+    for(const auto & interval : slots[i].intervals) {
+      const unsigned p=static_cast<unsigned>(interval.phase);
+// intervals of PlumedMain are named after the phase
+      const std::string name=(i>0?escape(slots[i].label):phaseName(p));
+      const char* cat=(i>0?phaseName(p):"plumed");
+      std::snprintf(buffer,sizeof(buffer),"\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"step\":%ld,\"cpu\":%.3f}}",
+                    cat,pid,interval.thread,1e-3*interval.start,1e-3*interval.wall,step,1e-3*interval.cpu);
+      writeEvent("{\"name\":\""+name+buffer);
+    }
+  }
+  const double ts=1e-3*nanoseconds(std::chrono::steady_clock::now()-origin);
+  std::snprintf(buffer,sizeof(buffer),"{\"name\":\"mpi\",\"ph\":\"C\",\"pid\":%d,\"ts\":%.3f,\"args\":{\"calls\":%lu,\"time\":%.9f}}",
+                pid,ts,Communicator::getCollectiveCalls()-mpiCalls0,getCollectiveTime());
+  writeEvent(buffer);
+  std::snprintf(buffer,sizeof(buffer),"{\"name\":\"shared_bytes\",\"ph\":\"C\",\"pid\":%d,\"ts\":%.3f,\"args\":{\"bytes\":%llu}}",
+                pid,ts,getSharedBytes());
+  writeEvent(buffer);
+}
+
+}
@@ -0,0 +1,157 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2011-2018 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_core_Profiler_h
+#define __PLUMED_core_Profiler_h
+
+#include "tools/OFile.h"
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace PLMD {
+
+class PlumedMain;
+class Action;
+class ActionSet;
+
+/**
+Class collecting per-action timings and counters.
+
+It is created with the PROFILE keyword of \ref DEBUG and owned by PlumedMain.
+For each action and for each phase (calculate, apply, update) it accumulates the
+number of calls, the wall time and the CPU time.
+Intervals recorded outside of OpenMP parallel regions use the CPU time of the whole process,
+so that the work done by the threads of an action is included.
+Intervals recorded inside a parallel region (e.g. actions calculated concurrently)
+use the CPU time of the calling thread, when the system provides it,
+since the process time would also include the work of the other actions.
+The same is done for the parts of the step that are not related to a single action
+(sharing data, waiting for data, and updating the forces of the MD code).
+It also reports the time spent in MPI collective operations (see Communicator::enableTiming())
+and the number of bytes moved by Atoms::share().
+
+Every stride steps the counters are written on a file, either with one JSON object per line
+(cumulative counters) or as Chrome trace events describing all the intervals recorded in that step.
+The latter can be opened with chrome://tracing or converted to a flamegraph.
+
+Counters for different actions are stored separately, so that actions calculated concurrently
+(see PLUMED_PARALLEL_ACTIONS) can be recorded from different threads.
+When no profiler is created the only cost is a check on a null pointer in PlumedMain.
+*/
+class Profiler {
+public:
+/// Phases that can be recorded
+  enum class Phase {calculate,apply,update,share,wait,forces};
+/// Instant in time when an interval started
+  struct Sample {
+    std::chrono::steady_clock::time_point wall;
+/// CPU time in nanoseconds
+    long long cpu;
+/// cpu is the time of the calling thread rather than of the process
+    bool threadCpu;
+  };
+/// Accumulated counters for an action (empty label for PlumedMain) and a phase
+  struct Total {
+    std::string label;
+    std::string phase;
+    unsigned long calls;
+    double wall;
+    double cpu;
+  };
+private:
+  static const unsigned nphases=6;
+/// A single interval, stored for the trace output
+  struct Interval {
+    Phase phase;
+    unsigned thread;
+    long long start;
+    long long wall;
+    long long cpu;
+  };
+/// Counters for a single action
+  struct Slot {
+    std::string label;
+    unsigned long calls[nphases];
+    long long wall[nphases];
+    long long cpu[nphases];
+    std::vector<Interval> intervals;
+    explicit Slot(const std::string&label);
+  };
+  PlumedMain& plumed;
+  OFile ofile;
+/// Counters are written on ofile
+  bool output;
+/// Write Chrome trace events rather than JSON lines
+  bool trace;
+  unsigned stride;
+  long int step;
+/// Intervals are only stored in trace mode, on steps that are written
+  bool sampling;
+/// Something was recorded since the last output
+  bool pending;
+/// No trace event has been written yet
+  bool firstEvent;
+  std::chrono::steady_clock::time_point origin;
+  double mpiTime0;
+  unsigned long mpiCalls0;
+  unsigned long long sharedBytes0;
+/// Slot 0 is used for PlumedMain itself, the others for the actions
+  std::vector<Slot> slots;
+  std::unordered_map<const Action*,unsigned> slotIndex;
+  static const char* phaseName(unsigned);
+  static std::string escape(const std::string&);
+/// Write the cumulative counters as JSON lines
+  void writeCounters();
+/// Write the intervals recorded in this step as trace events
+  void writeTrace();
+  void writeEvent(const std::string&);
+public:
+/// With an empty file name counters are only accumulated, and can be accessed with getTotals()
+  Profiler(PlumedMain&plumed,const std::string&file,const std::string&format,unsigned stride);
+  ~Profiler();
+/// Get the current instant, to be passed later to record()
+  static Sample now();
+/// Called at the beginning of each step, before any interval is recorded
+  void startStep(long int step,const ActionSet&);
+/// Record the interval from start to now.
+/// action should be NULL for the phases that are not related to an action.
+/// It can be called concurrently for different actions.
+/// When newCall is false the interval is added to the times of the phase
+/// without increasing the number of calls, which is useful when a single
+/// call is split in parts recorded separately.
+  void record(const Action*action,Phase phase,const Sample&start,bool newCall=true);
+/// Called at the end of each step, writes the counters every stride steps
+  void endStep();
+/// Set all the counters to zero
+  void reset();
+/// Get the counters of all the actions and phases that have been called
+  std::vector<Total> getTotals()const;
+/// Time (in seconds) spent in MPI collective operations
+  double getCollectiveTime()const;
+/// Number of bytes moved by Atoms::share()
+  unsigned long long getSharedBytes()const;
+};
+
+}
+
+#endif
@@ -23,6 +23,7 @@
 #include "core/ActionPilot.h"
 #include "core/ActionSet.h"
 #include "core/PlumedMain.h"
+#include "core/Profiler.h"
 
 using namespace std;
 
@@ -44,6 +45,25 @@ DEBUG DETAILED_TIMERS
 DEBUG logRequestedAtoms STRIDE=2
 \endplumedfile
 
+The PROFILE keyword can be used to write on a file, for each action, the number of calls
+and the wall and CPU time spent in the calculate, apply and update phases.
+The file also reports the time spent in sharing data with the MD code, in waiting for them,
+and in updating the MD forces, as well as the time spent in MPI collective operations
+and the number of bytes moved when sharing atoms with the MD code.
+The CPU time is the one of the whole process, so it includes the work done by OpenMP threads,
+except for actions that are calculated concurrently (see PLUMED_PARALLEL_ACTIONS in \ref Performances),
+for which the CPU time of the thread running the action is reported.
+With PROFILE_FORMAT=JSONL (default) cumulative counters are written every PROFILE_STRIDE steps,
+one JSON object per line.
+With PROFILE_FORMAT=TRACE all the intervals recorded in one step every PROFILE_STRIDE steps are written
+in the Chrome trace event format, that can be visualized with chrome://tracing or converted to a flamegraph.
+When this keyword is not used, profiling has no cost.
+
+\plumedfile
+# write a trace of every 100th step
+DEBUG PROFILE=profile.json PROFILE_FORMAT=TRACE PROFILE_STRIDE=100
+\endplumedfile
+
 */
 //+ENDPLUMEDOC
 class Debug:
@@ -73,6 +93,9 @@ void Debug::registerKeywords( Keywords& keys ) {
   keys.addFlag("NOVIRIAL",false,"switch off the virial contribution for the entirity of the simulation");
   keys.addFlag("DETAILED_TIMERS",false,"switch on detailed timers");
   keys.add("optional","FILE","the name of the file on which to output these quantities");
+  keys.add("optional","PROFILE","the name of the file on which to write per-action timings and counters");
+  keys.add("compulsory","PROFILE_FORMAT","JSONL","the format of the PROFILE file, either JSONL or TRACE");
+  keys.add("compulsory","PROFILE_STRIDE","100","the frequency with which the PROFILE file is written");
 }
 
 Debug::Debug(const ActionOptions&ao):
@@ -90,7 +113,17 @@ Debug::Debug(const ActionOptions&ao):
   if(novirial) plumed.novirial=true;
   parseFlag("DETAILED_TIMERS",detailedTimers);
   if(detailedTimers) log.printf("  Detailed timing on\n");
-  plumed.detailedTimers=true;
+  if(detailedTimers) plumed.detailedTimers=true;
+  std::string profile;
+  parse("PROFILE",profile);
+  std::string profileFormat;
+  parse("PROFILE_FORMAT",profileFormat);
+  unsigned profileStride=100;
+  parse("PROFILE_STRIDE",profileStride);
+  if(profile.length()>0) {
+    log.printf("  writing profile on file %s in %s format every %u steps\n",profile.c_str(),profileFormat.c_str(),profileStride);
+    plumed.profiler.reset(new Profiler(plumed,profile,profileFormat,profileStride));
+  }
   ofile.link(*this);
   std::string file;
   parse("FILE",file);
@@ -40,6 +40,7 @@
 #include "tools/Pbc.h"
 #include "tools/PDB.h"
 #include "tools/Torsion.h"
+#include "tools/VerletSkin.h"
 
 using namespace std;
 
@@ -470,6 +471,8 @@ class CS2Backbone : public MetainferenceBase {
   unsigned         max_cs_atoms;
   unsigned         box_nupdate;
   unsigned         box_count;
+  bool             box_skin;
+  VerletSkin       verlet;
   bool             camshift;
   bool             pbc;
   bool             serial;
@@ -488,6 +491,7 @@ class CS2Backbone : public MetainferenceBase {
 public:
 
   explicit CS2Backbone(const ActionOptions&);
+  ~CS2Backbone();
   static void registerKeywords( Keywords& keys );
   void calculate();
   void update();
@@ -505,6 +509,7 @@ void CS2Backbone::registerKeywords( Keywords& keys ) {
   keys.add("compulsory","DATADIR","data/","The folder with the experimental chemical shifts.");
   keys.add("compulsory","TEMPLATE","template.pdb","A PDB file of the protein system to initialise ALMOST.");
   keys.add("compulsory","NEIGH_FREQ","20","Period in step for neighbour list update.");
+  keys.add("optional","NEIGH_SKIN","Update the neighbour list only when atoms have moved by more than this distance, instead of every NEIGH_FREQ steps. It cannot be larger than 0.1 nm.");
   keys.addFlag("CAMSHIFT",false,"Set to TRUE if you to calculate a single CamShift score.");
   keys.addFlag("NOEXP",false,"Set to TRUE if you don't want to have fixed components with the experimetnal values.");
   keys.addOutputComponent("ha","default","the calculated Ha hydrogen chemical shifts");
@@ -524,6 +529,7 @@ void CS2Backbone::registerKeywords( Keywords& keys ) {
 CS2Backbone::CS2Backbone(const ActionOptions&ao):
   PLUMED_METAINF_INIT(ao),
   max_cs_atoms(0),
+  box_skin(false),
   camshift(false),
   pbc(true),
   serial(false)
@@ -553,6 +559,15 @@ CS2Backbone::CS2Backbone(const ActionOptions&ao):
   box_nupdate=20;
   parse("NEIGH_FREQ", box_nupdate);
 
+  double skin=0.;
+  parse("NEIGH_SKIN", skin);
+  if(skin>cutOffNB-cutOffDist) error("NEIGH_SKIN cannot be larger than the buffer of the neighbour list");
+  box_skin=(skin>0.);
+  // with a fixed frequency the buffer is used to detect when the neighbour list was not valid anymore
+  verlet.setSkin(box_skin?skin:cutOffNB-cutOffDist);
+  if(box_skin) log.printf("  neighbour list updated when atoms move by more than %f\n", skin);
+  else log.printf("  neighbour list updated every %u steps\n", box_nupdate);
+
   string stringadb  = stringa_data + string("/camshift.db");
   string stringapdb = stringa_data + string("/") + stringa_template;
 
@@ -948,11 +963,22 @@ void CS2Backbone::init_rings(const PDB &pdb)
   for(unsigned cs=0; cs<chemicalshifts.size(); cs++) chemicalshifts[cs].csatoms += total_rings_atoms;
 }
 
+CS2Backbone::~CS2Backbone() {
+  log<<verlet;
+}
+
 void CS2Backbone::calculate()
 {
   if(pbc) makeWhole();
-  if(getExchangeStep()) box_count=0;
-  if(box_count==0) update_neighb();
+  if(getExchangeStep()) {
+    box_count=0;
+    verlet.invalidate();
+  }
+  const Pbc* verlet_pbc=(pbc?&getPbc():nullptr);
+  bool rebuild;
+  if(box_skin) rebuild=verlet.needsUpdate(getPositions(),verlet_pbc);
+  else rebuild=verlet.scheduledUpdate(box_count==0,getPositions(),verlet_pbc);
+  if(rebuild) update_neighb();
   compute_ring_parameters();
 
   vector<double> camshift_sigma2(6);
@@ -26,6 +26,7 @@
 #include "core/SetupMolInfo.h"
 #include "core/ActionSet.h"
 #include "tools/File.h"
+#include "tools/VerletSkin.h"
 
 #include <string>
 #include <cmath>
@@ -152,6 +153,9 @@ private:
   unsigned nl_stride_;
   bool first_time_, no_aver_;
   vector < unsigned > nl_;
+// update neighbor list based on atomic displacements
+  bool nl_skin_;
+  VerletSkin verlet_;
 // parallel stuff
   unsigned size_;
   unsigned rank_;
@@ -196,6 +200,7 @@ private:
 public:
   static void registerKeywords( Keywords& keys );
   explicit EMMI(const ActionOptions&);
+  ~EMMI();
 // active methods:
   void prepare();
   virtual void calculate();
@@ -212,6 +217,8 @@ void EMMI::registerKeywords( Keywords& keys ) {
   keys.addFlag("ANALYSIS",false,"run in analysis mode");
   keys.add("compulsory","NL_CUTOFF","The cutoff in overlap for the neighbor list");
   keys.add("compulsory","NL_STRIDE","The frequency with which we are updating the neighbor list");
+  keys.add("optional","NL_SKIN","Update the neighbor list only when atoms have moved by more than this distance since the last update, instead of every NL_STRIDE steps. "
+           "Since the cutoff is on the overlap, the value should be chosen by checking that results do not change");
   keys.add("compulsory","SIGMA_MEAN","starting value for the uncertainty in the mean estimate");
   componentsAreNotOptional(keys);
   keys.addOutputComponent("score",   "default","Bayesian score");
@@ -224,6 +231,7 @@ EMMI::EMMI(const ActionOptions&ao):
   sqrt2_pi_(0.797884560802865),
   nl_cutoff_(-1.0), nl_stride_(0),
   first_time_(true), no_aver_(false),
+  nl_skin_(false),
   analysis_(false), nframe_(0.0), pbc_(true)
 {
 
@@ -253,6 +261,10 @@ EMMI::EMMI(const ActionOptions&ao):
   if(nl_cutoff_<=0.0) error("NL_CUTOFF should be explicitly specified and positive");
   parse("NL_STRIDE",nl_stride_);
   if(nl_stride_<=0) error("NL_STRIDE should be explicitly specified and positive");
+  double skin=0.0;
+  parse("NL_SKIN",skin);
+  nl_skin_=(skin>0.0);
+  verlet_.setSkin(skin);
 
   parseFlag("NO_AVER",no_aver_);
   parseFlag("ANALYSIS",analysis_);
@@ -285,7 +297,8 @@ EMMI::EMMI(const ActionOptions&ao):
   log.printf("  GMM data file : %s\n", GMM_file.c_str());
   if(no_aver_) log.printf("  without ensemble averaging\n");
   log.printf("  neighbor list overlap cutoff : %lf\n", nl_cutoff_);
-  log.printf("  neighbor list stride : %u\n",  nl_stride_);
+  if(nl_skin_) log.printf("  neighbor list updated when atoms move by more than %lf\n", skin);
+  else log.printf("  neighbor list stride : %u\n",  nl_stride_);
   log.printf("  uncertainty in the mean estimate %f\n",sigma_mean);
   log.printf("  temperature of the system in energy unit %f\n",kbt_);
   log.printf("  number of replicas %u\n",nrep_);
@@ -687,6 +700,11 @@ void EMMI::update_neighbor_list()
   ovmd_der_.resize(tot_size);
 }
 
+EMMI::~EMMI()
+{
+  log<<verlet_;
+}
+
 void EMMI::prepare()
 {
   if(getExchangeStep()) first_time_=true;
@@ -696,7 +714,11 @@ void EMMI::prepare()
 // overlap calculator
 void EMMI::calculate_overlap() {
 
-  if(first_time_ || getExchangeStep() || getStep()%nl_stride_==0) {
+  if(first_time_) verlet_.invalidate();
+  bool update;
+  if(nl_skin_) update=verlet_.needsUpdate(getPositions(), pbc_?&getPbc():nullptr);
+  else         update=verlet_.scheduledUpdate(getExchangeStep() || getStep()%nl_stride_==0, getPositions(), pbc_?&getPbc():nullptr);
+  if(update) {
     update_neighbor_list();
     first_time_=false;
   }
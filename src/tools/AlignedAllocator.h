@@ -0,0 +1,80 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2018 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_AlignedAllocator_h
+#define __PLUMED_tools_AlignedAllocator_h
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+
+namespace PLMD {
+
+/// \ingroup TOOLBOX
+/// Allocator that aligns the storage of a std::vector to a given number of bytes
+/// (by default 64, the size of the cache line of most processors).
+/// It can be used for large arrays that are split among threads or accessed with
+/// vector instructions, so that they start at the beginning of a cache line.
+/// \verbatim
+/// std::vector<double,AlignedAllocator<double> > v(1000);
+/// \endverbatim
+template <class T,std::size_t Alignment=64>
+class AlignedAllocator {
+public:
+  typedef T value_type;
+  template <class U> struct rebind {typedef AlignedAllocator<U,Alignment> other;};
+  AlignedAllocator() {}
+  template <class U> AlignedAllocator(const AlignedAllocator<U,Alignment>&) {}
+  T* allocate(std::size_t n);
+  void deallocate(T*p,std::size_t);
+};
+
+template <class T,std::size_t Alignment>
+T* AlignedAllocator<T,Alignment>::allocate(std::size_t n) {
+  static_assert((Alignment&(Alignment-1))==0,"alignment should be a power of two");
+// the pointer returned by malloc is stored just before the aligned block
+  void* p=std::malloc(n*sizeof(T)+Alignment+sizeof(void*));
+  if(!p) throw std::bad_alloc();
+  std::uintptr_t a=reinterpret_cast<std::uintptr_t>(p)+sizeof(void*);
+  a=(a+Alignment-1)&~static_cast<std::uintptr_t>(Alignment-1);
+  reinterpret_cast<void**>(a)[-1]=p;
+  return reinterpret_cast<T*>(a);
+}
+
+template <class T,std::size_t Alignment>
+void AlignedAllocator<T,Alignment>::deallocate(T*p,std::size_t) {
+  if(p) std::free(reinterpret_cast<void**>(p)[-1]);
+}
+
+template <class T,class U,std::size_t Alignment>
+bool operator==(const AlignedAllocator<T,Alignment>&,const AlignedAllocator<U,Alignment>&) {
+  return true;
+}
+
+template <class T,class U,std::size_t Alignment>
+bool operator!=(const AlignedAllocator<T,Alignment>&,const AlignedAllocator<U,Alignment>&) {
+  return false;
+}
+
+}
+
+#endif
@@ -22,11 +22,48 @@
 #include "Communicator.h"
 #include "Exception.h"
 #include <cstdlib>
+#include <atomic>
+#include <chrono>
 
 using namespace std;
 
 namespace PLMD {
 
+namespace {
+
+std::atomic<bool> timingEnabled(false);
+std::atomic<long long> timingNanoseconds(0);
+std::atomic<unsigned long> timingCalls(0);
+
+/// Accounts the time spent in a collective operation, from construction to destruction
+class CollectiveTimer {
+  bool on;
+  std::chrono::steady_clock::time_point start;
+public:
+  CollectiveTimer(): on(timingEnabled.load(std::memory_order_relaxed)) {
+    if(on) start=std::chrono::steady_clock::now();
+  }
+  ~CollectiveTimer() {
+    if(!on) return;
+    timingNanoseconds+=std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now()-start).count();
+    timingCalls++;
+  }
+};
+
+}
+
+void Communicator::enableTiming(bool on) {
+  timingEnabled=on;
+}
+
+double Communicator::getCollectiveTime() {
+  return 1e-9*timingNanoseconds.load();
+}
+
+unsigned long Communicator::getCollectiveCalls() {
+  return timingCalls.load();
+}
+
 Communicator::Communicator()
 #ifdef __PLUMED_HAS_MPI
   : communicator(MPI_COMM_SELF)
@@ -133,7 +170,10 @@ void Communicator::Abort(int errorcode) {
 
 void Communicator::Bcast(Data data,int root) {
 #if defined(__PLUMED_HAS_MPI)
-  if(initialized()) MPI_Bcast(data.pointer,data.size,data.type,root,communicator);
+  if(initialized()) {
+    CollectiveTimer timer;
+    MPI_Bcast(data.pointer,data.size,data.type,root,communicator);
+  }
 #else
   (void) data;
   (void) root;
@@ -142,7 +182,10 @@ void Communicator::Bcast(Data data,int root) {
 
 void Communicator::Sum(Data data) {
 #if defined(__PLUMED_HAS_MPI)
-  if(initialized()) MPI_Allreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_SUM,communicator);
+  if(initialized()) {
+    CollectiveTimer timer;
+    MPI_Allreduce(MPI_IN_PLACE,data.pointer,data.size,data.type,MPI_SUM,communicator);
+  }
 #else
   (void) data;
 #endif
@@ -171,6 +214,7 @@ void Communicator::Allgatherv(ConstData in,Data out,const int*recvcounts,const i
   int*rc=const_cast<int*>(recvcounts);
   int*di=const_cast<int*>(displs);
   if(s==NULL)s=MPI_IN_PLACE;
+  CollectiveTimer timer;
   MPI_Allgatherv(s,in.size,in.type,r,rc,di,out.type,communicator);
 #else
   (void) in;
@@ -187,6 +231,7 @@ void Communicator::Allgather(ConstData in,Data out) {
   void*s=const_cast<void*>((const void*)in.pointer);
   void*r=const_cast<void*>((const void*)out.pointer);
   if(s==NULL)s=MPI_IN_PLACE;
+  CollectiveTimer timer;
   MPI_Allgather(s,in.size,in.type,r,out.size/Get_size(),out.type,communicator);
 #else
   (void) in;
@@ -215,7 +260,10 @@ void Communicator::Recv(Data data,int source,int tag,Status&status) {
 
 void Communicator::Barrier()const {
 #ifdef __PLUMED_HAS_MPI
-  if(initialized()) MPI_Barrier(communicator);
+  if(initialized()) {
+    CollectiveTimer timer;
+    MPI_Barrier(communicator);
+  }
 #endif
 }
 
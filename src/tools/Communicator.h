@@ -173,6 +173,15 @@ public:
 /// Returns MPI_COMM_WORLD if MPI is initialized, otherwise the default communicator
   static Communicator & Get_world();
 
+/// Switch on/off the accounting of the time spent in collective operations.
+/// Counters are shared by all the communicators in the process and are only
+/// updated when accounting is on.
+  static void enableTiming(bool);
+/// Total time (in seconds) spent in collective operations
+  static double getCollectiveTime();
+/// Total number of collective operations
+  static unsigned long getCollectiveCalls();
+
 /// Wrapper for MPI_Allreduce with MPI_SUM (data struct)
   void Sum(Data);
 /// Wrapper for MPI_Allreduce with MPI_SUM (pointer)
@@ -0,0 +1,83 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2018 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "FloatPositions.h"
+#include "Pbc.h"
+#include <cmath>
+
+namespace PLMD {
+
+FloatPositions::FloatPositions():
+  pbc(nullptr),
+  ortho(false),
+  box{0.0,0.0,0.0},
+  invbox{0.0,0.0,0.0}
+{
+}
+
+void FloatPositions::set(const std::vector<Vector>&pos,const Pbc*p) {
+  const unsigned n=pos.size();
+  x.resize(n); y.resize(n); z.resize(n);
+  for(unsigned i=0; i<n; i++) {
+    x[i]=pos[i][0];
+    y[i]=pos[i][1];
+    z[i]=pos[i][2];
+  }
+  pbc=p;
+  ortho=false;
+  if(pbc && pbc->isSet() && pbc->isOrthorombic()) {
+    ortho=true;
+    const Tensor & b(pbc->getBox());
+    for(unsigned k=0; k<3; k++) {
+      box[k]=b(k,k);
+      invbox[k]=1.0/b(k,k);
+    }
+  }
+}
+
+void FloatPositions::distances(unsigned n,const unsigned*i0,const unsigned*i1,float*dx,float*dy,float*dz,float*d2)const {
+  const float* xx=x.data();
+  const float* yy=y.data();
+  const float* zz=z.data();
+  for(unsigned k=0; k<n; k++) {
+    dx[k]=xx[i1[k]]-xx[i0[k]];
+    dy[k]=yy[i1[k]]-yy[i0[k]];
+    dz[k]=zz[i1[k]]-zz[i0[k]];
+  }
+  if(ortho) {
+    const float bx=box[0],by=box[1],bz=box[2];
+    const float ix=invbox[0],iy=invbox[1],iz=invbox[2];
+    for(unsigned k=0; k<n; k++) {
+      dx[k]-=bx*std::floor(dx[k]*ix+0.5f);
+      dy[k]-=by*std::floor(dy[k]*iy+0.5f);
+      dz[k]-=bz*std::floor(dz[k]*iz+0.5f);
+    }
+  } else if(pbc && pbc->isSet()) {
+// generic cells are rare enough: minimal image is searched in double precision
+    for(unsigned k=0; k<n; k++) {
+      Vector d=pbc->distance(Vector(0.0,0.0,0.0),Vector(dx[k],dy[k],dz[k]));
+      dx[k]=d[0]; dy[k]=d[1]; dz[k]=d[2];
+    }
+  }
+  for(unsigned k=0; k<n; k++) d2[k]=dx[k]*dx[k]+dy[k]*dy[k]+dz[k]*dz[k];
+}
+
+}
@@ -0,0 +1,63 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2018 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_FloatPositions_h
+#define __PLUMED_tools_FloatPositions_h
+
+#include "Vector.h"
+#include <vector>
+
+namespace PLMD {
+
+class Pbc;
+
+/// \ingroup TOOLBOX
+/// Single precision copy of a set of positions, stored as
+/// separate x, y and z arrays.
+/// It is used by pair kernels working in mixed precision: distances are computed
+/// in single precision on blocks of pairs, whereas the caller is expected
+/// to accumulate the results in double precision.
+class FloatPositions {
+  std::vector<float> x,y,z;
+/// Pointer to pbc, nullptr if pbc should not be applied
+  const Pbc* pbc;
+/// True if the box is orthorombic and distances can be computed in single precision
+  bool ortho;
+/// Box edges and their inverse, only used if ortho is true
+  float box[3],invbox[3];
+public:
+  FloatPositions();
+/// Copy positions and box. If pbc is nullptr, no pbc are applied
+  void set(const std::vector<Vector>&pos,const Pbc*pbc);
+/// Number of stored positions
+  unsigned size()const;
+/// Compute the distance vectors pos[i1[k]]-pos[i0[k]] and their squared modulo for k=0..n-1
+  void distances(unsigned n,const unsigned*i0,const unsigned*i1,float*dx,float*dy,float*dz,float*d2)const;
+};
+
+inline
+unsigned FloatPositions::size()const {
+  return x.size();
+}
+
+}
+
+#endif
@@ -107,25 +107,20 @@ void Grid::Init(const std::string& funcl, const std::vector<std::string> &names,
   dospline_=dospline;
   usederiv_=usederiv;
   if(dospline_) plumed_assert(dospline_==usederiv_);
+  nvalues_=(usederiv_ ? 1+dimension_ : 1);
   maxsize_=1;
+  stride_.resize(dimension_);
   for(unsigned int i=0; i<dimension_; ++i) {
     dx_.push_back( (max_[i]-min_[i])/static_cast<double>( nbin_[i] ) );
     if( !pbc_[i] ) { max_[i] += dx_[i]; nbin_[i] += 1; }
+    stride_[i]=maxsize_;
     maxsize_*=nbin_[i];
   }
   if(doclear) clear();
 }
 
 void Grid::clear() {
-  grid_.resize(maxsize_);
-  if(usederiv_) der_.resize(maxsize_);
-  for(index_t i=0; i<maxsize_; ++i) {
-    grid_[i]=0.0;
-    if(usederiv_) {
-      (der_[i]).resize(dimension_);
-      for(unsigned int j=0; j<dimension_; ++j) der_[i][j]=0.0;
-    }
-  }
+  data_.assign(maxsize_*nvalues_,0.0);
 }
 
 vector<std::string> Grid::getMin() const {
@@ -192,6 +187,12 @@ Grid::index_t Grid::getIndex(const vector<double> & x) const {
 // we are flattening arrays using a column-major order
 vector<unsigned> Grid::getIndices(index_t index) const {
   vector<unsigned> indices(dimension_);
+  getIndices(index,indices);
+  return indices;
+}
+
+void Grid::getIndices(index_t index,vector<unsigned> & indices) const {
+  plumed_dbg_assert(indices.size()==dimension_);
   index_t kk=index;
   indices[0]=(index%nbin_[0]);
   for(unsigned int i=1; i<dimension_-1; ++i) {
@@ -201,7 +202,6 @@ vector<unsigned> Grid::getIndices(index_t index) const {
   if(dimension_>=2) {
     indices[dimension_-1]=((kk-indices[dimension_-2])/nbin_[dimension_-2]);
   }
-  return indices;
 }
 
 vector<unsigned> Grid::getIndices(const vector<double> & x) const {
@@ -383,14 +383,14 @@ void Grid::addKernel( const KernelFunctions& kernel ) {
 
 double Grid::getValue(index_t index) const {
   plumed_dbg_assert(index<maxsize_);
-  return grid_[index];
+  return data_[index*nvalues_];
 }
 
 double Grid::getMinValue() const {
   double minval;
   minval=DBL_MAX;
-  for(index_t i=0; i<grid_.size(); ++i) {
-    if(grid_[i]<minval)minval=grid_[i];
+  for(index_t k=0; k<data_.size(); k+=nvalues_) {
+    if(data_[k]<minval)minval=data_[k];
   }
   return minval;
 }
@@ -398,8 +398,8 @@ double Grid::getMinValue() const {
 double Grid::getMaxValue() const {
   double maxval;
   maxval=DBL_MIN;
-  for(index_t i=0; i<grid_.size(); ++i) {
-    if(grid_[i]>maxval)maxval=grid_[i];
+  for(index_t k=0; k<data_.size(); k+=nvalues_) {
+    if(data_[k]>maxval)maxval=data_[k];
   }
   return maxval;
 }
@@ -421,8 +421,9 @@ double Grid::getValue(const vector<double> & x) const {
 double Grid::getValueAndDerivatives
 (index_t index, vector<double>& der) const {
   plumed_dbg_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
-  der=der_[index];
-  return grid_[index];
+  const index_t k=index*nvalues_;
+  der.assign(data_.begin()+k+1,data_.begin()+k+nvalues_);
+  return data_[k];
 }
 
 double Grid::getValueAndDerivatives
@@ -435,56 +436,136 @@ double Grid::getValueAndDerivatives
   plumed_dbg_assert(der.size()==dimension_ && usederiv_);
 
   if(dospline_) {
-    double X,X2,X3,value;
-    vector<double> fd(dimension_);
-    vector<double> C(dimension_);
-    vector<double> D(dimension_);
-    vector<double> dder(dimension_);
+// the values of sparse grids are not stored in data_
+    if(isDense()) {
+      switch(dimension_) {
+      case 1: return getSplineValueAndDerivatives<1>(x,der);
+      case 2: return getSplineValueAndDerivatives<2>(x,der);
+      case 3: return getSplineValueAndDerivatives<3>(x,der);
+      case 4: return getSplineValueAndDerivatives<4>(x,der);
+      }
+    }
+    return getSplineValueAndDerivativesGeneric(x,der);
+  } else {
+    return getValueAndDerivatives(getIndex(x),der);
+  }
+}
+
+double Grid::getSplineValueAndDerivativesGeneric
+(const vector<double> & x, vector<double>& der) const {
+  double X,X2,X3,value;
+  vector<double> fd(dimension_);
+  vector<double> C(dimension_);
+  vector<double> D(dimension_);
+  vector<double> dder(dimension_);
 // reset
-    value=0.0;
-    for(unsigned int i=0; i<dimension_; ++i) der[i]=0.0;
+  value=0.0;
+  for(unsigned int i=0; i<dimension_; ++i) der[i]=0.0;
 
-    vector<unsigned> indices=getIndices(x);
-    vector<index_t> neigh=getSplineNeighbors(indices);
-    vector<double>   xfloor=getPoint(x);
+  vector<unsigned> indices=getIndices(x);
+  vector<index_t> neigh=getSplineNeighbors(indices);
+  vector<double>   xfloor=getPoint(x);
 
 // loop over neighbors
-    for(unsigned int ipoint=0; ipoint<neigh.size(); ++ipoint) {
-      double grid=getValueAndDerivatives(neigh[ipoint],dder);
-      vector<unsigned> nindices=getIndices(neigh[ipoint]);
-      double ff=1.0;
-
-      for(unsigned j=0; j<dimension_; ++j) {
-        int x0=1;
-        if(nindices[j]==indices[j]) x0=0;
-        double dx=getDx()[j];
-        X=fabs((x[j]-xfloor[j])/dx-(double)x0);
-        X2=X*X;
-        X3=X2*X;
-        double yy;
-        if(fabs(grid)<0.0000001) yy=0.0;
-        else yy=-dder[j]/grid;
-        C[j]=(1.0-3.0*X2+2.0*X3) - (x0?-1.0:1.0)*yy*(X-2.0*X2+X3)*dx;
-        D[j]=( -6.0*X +6.0*X2) - (x0?-1.0:1.0)*yy*(1.0-4.0*X +3.0*X2)*dx;
-        D[j]*=(x0?-1.0:1.0)/dx;
-        ff*=C[j];
-      }
-      for(unsigned j=0; j<dimension_; ++j) {
-        fd[j]=D[j];
-        for(unsigned i=0; i<dimension_; ++i) if(i!=j) fd[j]*=C[i];
+  for(unsigned int ipoint=0; ipoint<neigh.size(); ++ipoint) {
+    double grid=getValueAndDerivatives(neigh[ipoint],dder);
+    vector<unsigned> nindices=getIndices(neigh[ipoint]);
+    double ff=1.0;
+
+    for(unsigned j=0; j<dimension_; ++j) {
+      int x0=1;
+      if(nindices[j]==indices[j]) x0=0;
+      double dx=getDx()[j];
+      X=fabs((x[j]-xfloor[j])/dx-(double)x0);
+      X2=X*X;
+      X3=X2*X;
+      double yy;
+      if(fabs(grid)<0.0000001) yy=0.0;
+      else yy=-dder[j]/grid;
+      C[j]=(1.0-3.0*X2+2.0*X3) - (x0?-1.0:1.0)*yy*(X-2.0*X2+X3)*dx;
+      D[j]=( -6.0*X +6.0*X2) - (x0?-1.0:1.0)*yy*(1.0-4.0*X +3.0*X2)*dx;
+      D[j]*=(x0?-1.0:1.0)/dx;
+      ff*=C[j];
+    }
+    for(unsigned j=0; j<dimension_; ++j) {
+      fd[j]=D[j];
+      for(unsigned i=0; i<dimension_; ++i) if(i!=j) fd[j]*=C[i];
+    }
+    value+=grid*ff;
+    for(unsigned j=0; j<dimension_; ++j) der[j]+=grid*fd[j];
+  }
+  return value;
+}
+
+// same operations as in getSplineValueAndDerivativesGeneric, but the 2^N neighbors
+// are indexed directly with the strides and all the temporaries are on the stack
+template<unsigned N>
+double Grid::getSplineValueAndDerivatives
+(const vector<double> & x, vector<double>& der) const {
+  unsigned indices[N];
+  double xfloor[N], dx[N];
+  unsigned nbin[N];
+  bool pbc[N];
+  index_t stride[N];
+  for(unsigned j=0; j<N; ++j) {
+    dx[j]=dx_[j];
+    nbin[j]=nbin_[j];
+    pbc[j]=pbc_[j];
+    stride[j]=stride_[j];
+    indices[j]=unsigned(floor((x[j]-min_[j])/dx[j]));
+    xfloor[j]=min_[j]+(double)(indices[j])*dx[j];
+    der[j]=0.0;
+  }
+  double value=0.0;
+  double C[N], D[N];
+  int x0[N];
+
+  for(unsigned ipoint=0; ipoint<(1u<<N); ++ipoint) {
+    index_t index=0;
+    bool inside=true;
+    for(unsigned j=0; j<N; ++j) {
+      unsigned i0=indices[j]+((ipoint>>j)&1);
+      if(!pbc[j] && i0==nbin[j]) {inside=false; break;}
+      if( pbc[j] && i0==nbin[j]) i0=0;
+      if(i0>=nbin[j]) {
+        std::string is;
+        Tools::convert(j,is);
+        std::string msg="ERROR: the system is looking for a value outside the grid along the " + is + " ("+argnames[j]+")";
+        plumed_merror(msg+" index!");
       }
-      value+=grid*ff;
-      for(unsigned j=0; j<dimension_; ++j) der[j]+=grid*fd[j];
+      x0[j]=(i0==indices[j]) ? 0 : 1;
+      index+=i0*stride[j];
     }
-    return value;
-  } else {
-    return getValueAndDerivatives(getIndex(x),der);
+    if(!inside) continue;
+
+    const double grid=data_[index*nvalues_];
+    const double* dder=&data_[index*nvalues_+1];
+    double ff=1.0;
+    for(unsigned j=0; j<N; ++j) {
+      double X=fabs((x[j]-xfloor[j])/dx[j]-(double)x0[j]);
+      double X2=X*X;
+      double X3=X2*X;
+      double yy;
+      if(fabs(grid)<0.0000001) yy=0.0;
+      else yy=-dder[j]/grid;
+      C[j]=(1.0-3.0*X2+2.0*X3) - (x0[j]?-1.0:1.0)*yy*(X-2.0*X2+X3)*dx[j];
+      D[j]=( -6.0*X +6.0*X2) - (x0[j]?-1.0:1.0)*yy*(1.0-4.0*X +3.0*X2)*dx[j];
+      D[j]*=(x0[j]?-1.0:1.0)/dx[j];
+      ff*=C[j];
+    }
+    for(unsigned j=0; j<N; ++j) {
+      double fd=D[j];
+      for(unsigned i=0; i<N; ++i) if(i!=j) fd*=C[i];
+      der[j]+=grid*fd;
+    }
+    value+=grid*ff;
   }
+  return value;
 }
 
 void Grid::setValue(index_t index, double value) {
   plumed_dbg_assert(index<maxsize_ && !usederiv_);
-  grid_[index]=value;
+  data_[index*nvalues_]=value;
 }
 
 void Grid::setValue(const vector<unsigned> & indices, double value) {
@@ -494,8 +575,9 @@ void Grid::setValue(const vector<unsigned> & indices, double value) {
 void Grid::setValueAndDerivatives
 (index_t index, double value, vector<double>& der) {
   plumed_dbg_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
-  grid_[index]=value;
-  der_[index]=der;
+  const index_t k=index*nvalues_;
+  data_[k]=value;
+  for(unsigned int i=0; i<dimension_; ++i) data_[k+1+i]=der[i];
 }
 
 void Grid::setValueAndDerivatives
@@ -505,7 +587,7 @@ void Grid::setValueAndDerivatives
 
 void Grid::addValue(index_t index, double value) {
   plumed_dbg_assert(index<maxsize_ && !usederiv_);
-  grid_[index]+=value;
+  data_[index*nvalues_]+=value;
 }
 
 void Grid::addValue(const vector<unsigned> & indices, double value) {
@@ -515,8 +597,9 @@ void Grid::addValue(const vector<unsigned> & indices, double value) {
 void Grid::addValueAndDerivatives
 (index_t index, double value, vector<double>& der) {
   plumed_dbg_assert(index<maxsize_ && usederiv_ && der.size()==dimension_);
-  grid_[index]+=value;
-  for(unsigned int i=0; i<dimension_; ++i) der_[index][i]+=der[i];
+  const index_t k=index*nvalues_;
+  data_[k]+=value;
+  for(unsigned int i=0; i<dimension_; ++i) data_[k+1+i]+=der[i];
 }
 
 void Grid::addValueAndDerivatives
@@ -524,42 +607,52 @@ void Grid::addValueAndDerivatives
   addValueAndDerivatives(getIndex(indices),value,der);
 }
 
-void Grid::scaleAllValuesAndDerivatives( const double& scalef ) {
-  if(usederiv_) {
-    for(index_t i=0; i<grid_.size(); ++i) {
-      grid_[i]*=scalef;
-      for(unsigned j=0; j<dimension_; ++j) der_[i][j]*=scalef;
+void Grid::addBlock(index_t index, index_t npoints, const double* block) {
+  plumed_dbg_assert(index+npoints<=maxsize_);
+  if(!isDense()) {
+    // sparse grids go through the virtual methods
+    vector<double> der(dimension_);
+    for(index_t i=0; i<npoints; ++i) {
+      const double* point=block+i*nvalues_;
+      if(usederiv_) {
+        for(unsigned j=0; j<dimension_; ++j) der[j]=point[1+j];
+        addValueAndDerivatives(index+i,point[0],der);
+      } else {
+        addValue(index+i,point[0]);
+      }
     }
-  } else {
-    for(index_t i=0; i<grid_.size(); ++i) grid_[i]*=scalef;
+    return;
   }
+  double* target=&data_[index*nvalues_];
+  const index_t n=npoints*nvalues_;
+  for(index_t k=0; k<n; ++k) target[k]+=block[k];
+}
+
+void Grid::scaleAll(double scalef) {
+  for(index_t k=0; k<data_.size(); ++k) data_[k]*=scalef;
+}
+
+void Grid::scaleAllValuesAndDerivatives( const double& scalef ) {
+  scaleAll(scalef);
 }
 
 void Grid::logAllValuesAndDerivatives( const double& scalef ) {
-  if(usederiv_) {
-    for(index_t i=0; i<grid_.size(); ++i) {
-      grid_[i] = scalef*log(grid_[i]);
-      for(unsigned j=0; j<dimension_; ++j) der_[i][j] = scalef/der_[i][j];
-    }
-  } else {
-    for(index_t i=0; i<grid_.size(); ++i) grid_[i] = scalef*log(grid_[i]);
+  for(index_t k=0; k<data_.size(); k+=nvalues_) {
+    data_[k] = scalef*log(data_[k]);
+    for(unsigned j=1; j<nvalues_; ++j) data_[k+j] = scalef/data_[k+j];
   }
 }
 
 void Grid::setMinToZero() {
-  double min=grid_[0];
-  for(index_t i=1; i<grid_.size(); ++i) if(grid_[i]<min) min=grid_[i];
-  for(index_t i=0; i<grid_.size(); ++i) grid_[i] -= min;
+  double min=data_[0];
+  for(index_t k=nvalues_; k<data_.size(); k+=nvalues_) if(data_[k]<min) min=data_[k];
+  for(index_t k=0; k<data_.size(); k+=nvalues_) data_[k] -= min;
 }
 
 void Grid::applyFunctionAllValuesAndDerivatives( double (*func)(double val), double (*funcder)(double valder) ) {
-  if(usederiv_) {
-    for(index_t i=0; i<grid_.size(); ++i) {
-      grid_[i]=func(grid_[i]);
-      for(unsigned j=0; j<dimension_; ++j) der_[i][j]=funcder(der_[i][j]);
-    }
-  } else {
-    for(index_t i=0; i<grid_.size(); ++i) grid_[i]=func(grid_[i]);
+  for(index_t k=0; k<data_.size(); k+=nvalues_) {
+    data_[k]=func(data_[k]);
+    for(unsigned j=1; j<nvalues_; ++j) data_[k+j]=funcder(data_[k+j]);
   }
 }
 
@@ -970,7 +1063,7 @@ double Grid::integrate( std::vector<unsigned>& npoints ) {
 }
 
 void Grid::mpiSumValuesAndDerivatives( Communicator& comm ) {
-  comm.Sum( grid_ ); for(unsigned i=0; i<der_.size(); ++i) comm.Sum( der_[i] );
+  comm.Sum( data_.data(), data_.size() );
 }
 
 
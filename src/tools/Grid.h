@@ -22,6 +22,7 @@
 #ifndef __PLUMED_tools_Grid_h
 #define __PLUMED_tools_Grid_h
 
+#include "AlignedAllocator.h"
 #include <vector>
 #include <string>
 #include <map>
@@ -79,14 +80,22 @@ public:
 // typedef unsigned index_t;
 private:
   double contour_location;
-  std::vector<double> grid_;
-  std::vector< std::vector<double> > der_;
+/// values and derivatives of all the points, stored as the value of each point followed by its derivatives.
+/// the array starts at a cache line boundary, so that threads working on different blocks of points
+/// share at most the cache lines at the borders of their blocks
+  std::vector<double,AlignedAllocator<double> > data_;
+/// number of doubles stored for each point (1 or 1+dimension_)
+  unsigned nvalues_;
+/// check if the values are stored in data_ (i.e. this is not a sparse grid)
+  bool isDense() const {return data_.size()==maxsize_*nvalues_;}
 protected:
   std::string funcname;
   std::vector<std::string> argnames;
   std::vector<std::string> str_min_, str_max_;
   std::vector<double> min_,max_,dx_;
   std::vector<unsigned> nbin_;
+/// distance between consecutive grid points along each dimension in the flattened array
+  std::vector<index_t> stride_;
   std::vector<bool> pbc_;
   index_t maxsize_;
   unsigned dimension_;
@@ -94,6 +103,10 @@ protected:
   std::string fmt_; // format for output
 /// get "neighbors" for spline
   std::vector<index_t> getSplineNeighbors(const std::vector<unsigned> & indices)const;
+/// spline interpolation for any dimension, used for sparse grids and for more than four dimensions
+  double getSplineValueAndDerivativesGeneric(const std::vector<double> & x, std::vector<double>& der) const;
+/// spline interpolation for dense grids of dimension N without any heap allocations
+  template<unsigned N> double getSplineValueAndDerivatives(const std::vector<double> & x, std::vector<double>& der) const;
 
 
 public:
@@ -140,6 +153,7 @@ public:
   std::vector<double> getPoint(const std::vector<unsigned> & indices) const;
   std::vector<double> getPoint(const std::vector<double> & x) const;
 /// faster versions relying on preallocated vectors
+  void getIndices(index_t index,std::vector<unsigned> & indices) const;
   void getPoint(index_t index,std::vector<double> & point) const;
   void getPoint(const std::vector<unsigned> & indices,std::vector<double> & point) const;
   void getPoint(const std::vector<double> & x,std::vector<double> & point) const;
@@ -202,6 +216,13 @@ public:
   virtual void applyFunctionAllValuesAndDerivatives( double (*func)(double val), double (*funcder)(double valder) );
 /// add a kernel function to the grid
   void addKernel( const KernelFunctions& kernel );
+/// add to npoints consecutive points starting from index, block contains for each point
+/// the value followed by the derivatives (if the grid has them)
+  void addBlock(index_t index, index_t npoints, const double* block);
+/// scale all values and derivatives stored in the grid by a constant factor
+  void scaleAll(double scalef);
+/// replace each value (but not the derivatives) with func(index,value), points are visited in order
+  template<class Function> void mapValues(Function func);
 
 /// dump grid on file
   virtual void writeToFile(OFile&);
@@ -228,6 +249,12 @@ public:
 };
 
 
+template<class Function>
+void Grid::mapValues(Function func) {
+  for(index_t i=0, k=0; k<data_.size(); ++i, k+=nvalues_) data_[k]=func(i,data_[k]);
+}
+
+
 class SparseGrid : public Grid
 {
 
@@ -20,4 +20,30 @@
    along with plumed.  If not, see <http://www.gnu.org/licenses/>.
 +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
 #include "Log.h"
+#include "Exception.h"
+#include <cstdarg>
+#include <cstdio>
+#include <vector>
 
+namespace PLMD {
+
+int Log::printf(const char*fmt,...) {
+// the string is formatted before locking, so that only the write is serialized
+  std::vector<char> buffer(1024);
+  va_list arg;
+  va_start(arg, fmt);
+  int r=std::vsnprintf(&buffer[0],buffer.size(),fmt,arg);
+  va_end(arg);
+  plumed_massert(r>-1,"error using fmt string " + std::string(fmt));
+  if(r>=static_cast<int>(buffer.size())) {
+    buffer.resize(r+1);
+    va_start(arg, fmt);
+    std::vsnprintf(&buffer[0],buffer.size(),fmt,arg);
+    va_end(arg);
+  }
+  std::lock_guard<std::mutex> lock(mtx);
+  OFile::printf("%s",&buffer[0]);
+  return r;
+}
+
+}
@@ -23,6 +23,8 @@
 #define __PLUMED_tools_Log_h
 
 #include "OFile.h"
+#include <mutex>
+#include <sstream>
 
 namespace PLMD {
 
@@ -32,11 +34,33 @@ namespace PLMD {
 /// also to write with a << operator. Moreover, it can prefix
 /// lines with the "PLUMED:" prefix, useful to grep out plumed
 /// log from output
+///
+/// Writing is serialized, so that actions calculated concurrently
+/// (see PLUMED_PARALLEL_ACTIONS) can write on the log.
+/// Each call to printf() or << is written as a whole, but lines
+/// written with several calls by different threads can be interleaved.
 class Log :
   public OFile
 {
+  std::mutex mtx;
+public:
+/// Formatted output with explicit format - a la printf
+  int printf(const char*fmt,...);
+/// Formatted output with << operator
+  template <class T>
+  friend Log& operator<<(Log&,const T &);
 };
 
+/// Write using << syntax
+template <class T>
+Log& operator<<(Log&log,const T &t) {
+  std::ostringstream oss;
+  oss<<t;
+  std::lock_guard<std::mutex> lock(log.mtx);
+  log.OFile::printf("%s",oss.str().c_str());
+  return log;
+}
+
 }
 
 #endif
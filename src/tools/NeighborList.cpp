@@ -24,6 +24,9 @@
 #include "Pbc.h"
 #include "AtomNumber.h"
 #include "Tools.h"
+#include "Communicator.h"
+#include "LinkCells.h"
+#include "OpenMP.h"
 #include <vector>
 #include <algorithm>
 
@@ -34,7 +37,9 @@ NeighborList::NeighborList(const vector<AtomNumber>& list0, const vector<AtomNum
                            const bool& do_pair, const bool& do_pbc, const Pbc& pbc,
                            const double& distance, const unsigned& stride): reduced(false),
   do_pair_(do_pair), do_pbc_(do_pbc), pbc_(&pbc),
-  distance_(distance), stride_(stride)
+  distance_(distance), stride_(stride),
+  serialcomm_(new Communicator),
+  linkcells_(new LinkCells(*serialcomm_))
 {
 // store full list of atoms needed
   fullatomlist_=list0;
@@ -57,7 +62,10 @@ NeighborList::NeighborList(const vector<AtomNumber>& list0, const bool& do_pbc,
                            const Pbc& pbc, const double& distance,
                            const unsigned& stride): reduced(false),
   do_pbc_(do_pbc), pbc_(&pbc),
-  distance_(distance), stride_(stride) {
+  distance_(distance), stride_(stride),
+  serialcomm_(new Communicator),
+  linkcells_(new LinkCells(*serialcomm_))
+{
   fullatomlist_=list0;
   nlist0_=list0.size();
   twolists_=false;
@@ -66,6 +74,10 @@ NeighborList::NeighborList(const vector<AtomNumber>& list0, const bool& do_pbc,
   lastupdate_=0;
 }
 
+NeighborList::~NeighborList() {
+// destructor required to delete forward declared classes
+}
+
 void NeighborList::initialize() {
   neighbors_.clear();
   for(unsigned int i=0; i<nallpairs_; ++i) {
@@ -94,9 +106,16 @@ pair<unsigned,unsigned> NeighborList::getIndexPair(unsigned ipair) {
 
 void NeighborList::update(const vector<Vector>& positions) {
   neighbors_.clear();
-  const double d2=distance_*distance_;
 // check if positions array has the correct length
   plumed_assert(positions.size()==fullatomlist_.size());
+// link cells are only useful when a cutoff is set and all pairs of two lists are searched
+  if(distance_<1.0e+30 && !(twolists_ && do_pair_)) updateLinkCells(positions);
+  else updateAllPairs(positions);
+  setRequestList();
+}
+
+void NeighborList::updateAllPairs(const vector<Vector>& positions) {
+  const double d2=distance_*distance_;
   for(unsigned int i=0; i<nallpairs_; ++i) {
     pair<unsigned,unsigned> index=getIndexPair(i);
     unsigned index0=index.first;
@@ -110,15 +129,90 @@ void NeighborList::update(const vector<Vector>& positions) {
     double value=modulo2(distance);
     if(value<=d2) {neighbors_.push_back(index);}
   }
-  setRequestList();
+}
+
+void NeighborList::updateLinkCells(const vector<Vector>& positions) {
+  const double d2=distance_*distance_;
+  if(positions.empty()) return;
+// atoms in the second list (or all the atoms if there is a single list) are binned in cells
+  const unsigned first=(twolists_?nlist0_:0);
+  vector<unsigned> cellind(positions.size()-first);
+  for(unsigned i=0; i<cellind.size(); i++) cellind[i]=first+i;
+
+// without pbc, cells are built in a fictitious orthorombic box large enough
+// that periodic images are never closer than the cutoff
+  Pbc cellpbc;
+  vector<Vector> shifted;
+  const vector<Vector>* cellframe=&positions;
+  if(do_pbc_ && pbc_->isSet()) {
+    cellpbc.setBox(pbc_->getBox());
+  } else {
+    Vector lower(positions[0]),upper(positions[0]);
+    for(const auto & p : positions) for(unsigned k=0; k<3; k++) {
+        lower[k]=std::min(lower[k],p[k]);
+        upper[k]=std::max(upper[k],p[k]);
+      }
+    Vector center=0.5*(lower+upper);
+    Tensor box;
+    for(unsigned k=0; k<3; k++) box(k,k)=upper[k]-lower[k]+2.0*distance_;
+    cellpbc.setBox(box);
+    shifted.resize(positions.size());
+    for(unsigned i=0; i<positions.size(); i++) shifted[i]=positions[i]-center;
+    cellframe=&shifted;
+  }
+  vector<Vector> cellpos(cellframe->begin()+first,cellframe->end());
+
+  linkcells_->setCutoff(distance_);
+  linkcells_->buildCellLists(cellpos,cellind,cellpbc);
+
+// atoms of the first list are split in contiguous chunks, one per thread.
+// Since each chunk is sorted, concatenating them reproduces the order of updateAllPairs()
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*10>nlist0_) nt=nlist0_/10;
+  if(nt==0) nt=1;
+  vector<vector<pair<unsigned,unsigned> > > chunks(nt);
+
+  #pragma omp parallel num_threads(nt)
+  {
+    vector<unsigned> cells(linkcells_->getNumberOfCells());
+    vector<unsigned> atoms(1+cellpos.size());
+    #pragma omp for schedule(static,1)
+    for(unsigned c=0; c<nt; c++) {
+      for(unsigned i=c*nlist0_/nt; i<(c+1)*nlist0_/nt; i++) {
+        unsigned natoms=1;
+        atoms[0]=i;
+        linkcells_->retrieveNeighboringAtoms((*cellframe)[i],cells,natoms,atoms);
+        std::sort(atoms.begin()+1,atoms.begin()+natoms);
+        for(unsigned k=1; k<natoms; k++) {
+          const unsigned j=atoms[k];
+          if(!twolists_ && j<=i) continue;
+          Vector distance;
+          if(do_pbc_) {
+            distance=pbc_->distance(positions[i],positions[j]);
+          } else {
+            distance=delta(positions[i],positions[j]);
+          }
+          if(modulo2(distance)<=d2) chunks[c].push_back(pair<unsigned,unsigned>(i,j));
+        }
+      }
+    }
+  }
+
+  size_t tot=0;
+  for(const auto & c : chunks) tot+=c.size();
+  neighbors_.reserve(tot);
+  for(const auto & c : chunks) neighbors_.insert(neighbors_.end(),c.begin(),c.end());
 }
 
 void NeighborList::setRequestList() {
   requestlist_.clear();
+// mark the atoms first, so that duplicates are only removed from the list of atoms
+  vector<bool> used(fullatomlist_.size(),false);
   for(unsigned int i=0; i<size(); ++i) {
-    requestlist_.push_back(fullatomlist_[neighbors_[i].first]);
-    requestlist_.push_back(fullatomlist_[neighbors_[i].second]);
+    used[neighbors_[i].first]=true;
+    used[neighbors_[i].second]=true;
   }
+  for(unsigned int i=0; i<used.size(); ++i) if(used[i]) requestlist_.push_back(fullatomlist_[i]);
   Tools::removeDuplicates(requestlist_);
   reduced=false;
 }
@@ -129,8 +223,8 @@ vector<AtomNumber>& NeighborList::getReducedAtomList() {
       AtomNumber index0=fullatomlist_[neighbors_[i].first];
       AtomNumber index1=fullatomlist_[neighbors_[i].second];
 // I exploit the fact that requestlist_ is an ordered vector
-      auto p = std::find(requestlist_.begin(), requestlist_.end(), index0); plumed_assert(p!=requestlist_.end()); newindex0=p-requestlist_.begin();
-      p = std::find(requestlist_.begin(), requestlist_.end(), index1); plumed_assert(p!=requestlist_.end()); newindex1=p-requestlist_.begin();
+      auto p = std::lower_bound(requestlist_.begin(), requestlist_.end(), index0); plumed_assert(p!=requestlist_.end() && *p==index0); newindex0=p-requestlist_.begin();
+      p = std::lower_bound(requestlist_.begin(), requestlist_.end(), index1); plumed_assert(p!=requestlist_.end() && *p==index1); newindex1=p-requestlist_.begin();
       neighbors_[i]=pair<unsigned,unsigned>(newindex0,newindex1);
     }
   reduced=true;
@@ -153,10 +247,6 @@ unsigned NeighborList::size() const {
   return neighbors_.size();
 }
 
-pair<unsigned,unsigned> NeighborList::getClosePair(unsigned i) const {
-  return neighbors_[i];
-}
-
 vector<unsigned> NeighborList::getNeighbors(unsigned index) {
   vector<unsigned> neighbors;
   for(unsigned int i=0; i<size(); ++i) {
@@ -26,10 +26,13 @@
 #include "AtomNumber.h"
 
 #include <vector>
+#include <memory>
 
 namespace PLMD {
 
 class Pbc;
+class Communicator;
+class LinkCells;
 
 /// \ingroup TOOLBOX
 /// A class that implements neighbor lists from two lists or a single list of atoms
@@ -42,6 +45,10 @@ class NeighborList
   std::vector<std::pair<unsigned,unsigned> > neighbors_;
   double distance_;
   unsigned stride_,nlist0_,nlist1_,nallpairs_,lastupdate_;
+/// Serial communicator used by the link cells
+  std::unique_ptr<Communicator> serialcomm_;
+/// Link cells used to rebuild the list when a cutoff is set
+  std::unique_ptr<LinkCells> linkcells_;
 /// Initialize the neighbor list with all possible pairs
   void initialize();
 /// Return the pair of indexes in the positions array
@@ -49,6 +56,11 @@ class NeighborList
   std::pair<unsigned,unsigned> getIndexPair(unsigned i);
 /// Extract the list of atoms from the current list of close pairs
   void setRequestList();
+/// Compute the list of close pairs checking all possible pairs
+  void updateAllPairs(const std::vector<PLMD::Vector>& positions);
+/// Compute the list of close pairs using link cells.
+/// Pairs are found in the same order as in updateAllPairs()
+  void updateLinkCells(const std::vector<PLMD::Vector>& positions);
 public:
   NeighborList(const std::vector<PLMD::AtomNumber>& list0,
                const std::vector<PLMD::AtomNumber>& list1,
@@ -78,9 +90,14 @@ public:
   std::pair<unsigned,unsigned> getClosePair(unsigned i) const;
 /// Get the list of neighbors of the i-th atom
   std::vector<unsigned> getNeighbors(unsigned i);
-  ~NeighborList() {}
+  ~NeighborList();
 };
 
+inline
+std::pair<unsigned,unsigned> NeighborList::getClosePair(unsigned i) const {
+  return neighbors_[i];
+}
+
 }
 
 #endif
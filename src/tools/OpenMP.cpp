@@ -35,7 +35,16 @@ unsigned OpenMP::getCachelineSize() {
   return cachelineSize;
 }
 
+namespace {
+unsigned numThreadsOverride=0;
+}
+
+void OpenMP::setNumThreads(unsigned n) {
+  numThreadsOverride=n;
+}
+
 unsigned OpenMP::getNumThreads() {
+  if(numThreadsOverride>0) return numThreadsOverride;
   static unsigned numThreads=1;
   if(std::getenv("PLUMED_NUM_THREADS")) Tools::convert(std::getenv("PLUMED_NUM_THREADS"),numThreads);
   return numThreads;
@@ -49,6 +58,14 @@ unsigned OpenMP::getThreadNum() {
 #endif
 }
 
+bool OpenMP::inParallel() {
+#if defined(_OPENMP)
+  return omp_in_parallel();
+#else
+  return false;
+#endif
+}
+
 
 
 }
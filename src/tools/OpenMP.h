@@ -33,9 +33,15 @@ public:
 /// Get number of threads that can be used by openMP
   static unsigned getNumThreads();
 
+/// Set the number of threads, overriding PLUMED_NUM_THREADS (0 restores the environment value)
+  static void setNumThreads(unsigned);
+
 /// Returns a unique thread identification number within the current team
   static unsigned getThreadNum();
 
+/// Returns true when called inside an active parallel region
+  static bool inParallel();
+
 /// get cacheline size
   static unsigned getCachelineSize();
 
@@ -173,6 +173,17 @@ removed in the future. Similarly, the STRETCH keyword is still allowed but has n
 Notice that switching functions defined with the simplified syntax are never stretched
 for backward compatibility. This might change in the future.
 
+When a D_MAX is set, the switching function can also be replaced by a table with the keyword TABLE,
+which gives the number of intervals used to interpolate it as a function of \f$r^2\f$ between 0 and \f$d_{\textrm{max}}^2\f$.
+In each interval the function is a cubic polynomial matching value and derivative at the edges, so that
+forces are the exact derivative of the interpolated function.
+\verbatim
+KEYWORD={CUSTOM FUNC=exp(-x^2) R_0=0.3 D_MAX=1.0 TABLE=2000}
+\endverbatim
+This is useful to speed up expensive functions (e.g. CUSTOM or RATIONAL with large exponents) when computed
+on many pairs. The accuracy of the table should be checked, in particular for functions whose derivative
+is not smooth at \f$r=0\f$ (e.g. EXP).
+
 */
 //+ENDPLUMEDOC
 
@@ -180,6 +191,7 @@ void SwitchingFunction::registerKeywords( Keywords& keys ) {
   keys.add("compulsory","R_0","the value of R_0 in the switching function");
   keys.add("compulsory","D_0","0.0","the value of D_0 in the switching function");
   keys.add("optional","D_MAX","the value at which the switching function can be assumed equal to zero");
+  keys.add("optional","TABLE","the number of intervals used to tabulate the switching function (requires D_MAX)");
   keys.add("compulsory","NN","6","the value of n in the switching function (only needed for TYPE=RATIONAL)");
   keys.add("compulsory","MM","0","the value of m in the switching function (only needed for TYPE=RATIONAL); 0 implies 2*NN");
   keys.add("compulsory","A","the value of a in the switching funciton (only needed for TYPE=SMAP)");
@@ -193,6 +205,9 @@ void SwitchingFunction::set(const std::string & definition,std::string& errormsg
   data.erase(data.begin());
   invr0=0.0;
   invr0_2=0.0;
+  table.clear();
+  kernel=nullptr;
+  kernelSqr=nullptr;
   d0=0.0;
   dmax=std::numeric_limits<double>::max();
   dmax_2=std::numeric_limits<double>::max();
@@ -208,6 +223,10 @@ void SwitchingFunction::set(const std::string & definition,std::string& errormsg
   present=Tools::findKeyword(data,"D_MAX");
   if(present && !Tools::parse(data,"D_MAX",dmax)) errormsg="could not parse D_MAX";
   if(dmax<std::sqrt(std::numeric_limits<double>::max())) dmax_2=dmax*dmax;
+  unsigned ntable=0;
+  present=Tools::findKeyword(data,"TABLE");
+  if(present && !Tools::parse(data,"TABLE",ntable)) errormsg="could not parse TABLE";
+  if(ntable>0 && dmax==std::numeric_limits<double>::max()) errormsg="TABLE requires D_MAX";
   bool dostretch=false;
   Tools::parseFlag(data,"STRETCH",dostretch); // this is ignored now
   dostretch=true;
@@ -312,8 +331,45 @@ void SwitchingFunction::set(const std::string & definition,std::string& errormsg
     stretch=1.0/(s0-sd);
     shift=-sd*stretch;
   }
+  setupKernels();
   plumed_assert(!(leptonx2 && d0!=0.0)) << "You cannot use lepton x2 optimization with d0!=0.0 (d0=" << d0 <<")\n"
                                         << "Please rewrite your function using x as a variable";
+
+  if(ntable>0 && errormsg.empty()) setupTable(ntable);
+}
+
+void SwitchingFunction::setupTable(unsigned n) {
+// function and derivative with respect to x**2 are computed exactly at the edges of the intervals
+  table.clear();
+  const double h=dmax_2/n;
+  vector<double> f(n+1),df(n+1);
+  for(unsigned i=0; i<=n; i++) {
+    f[i]=calculateSqr(i*h,df[i]);
+    df[i]*=0.5*h;
+  }
+  table.resize(4*n);
+  for(unsigned i=0; i<n; i++) {
+    table[4*i]=f[i];
+    table[4*i+1]=df[i];
+    table[4*i+2]=3.0*(f[i+1]-f[i])-2.0*df[i]-df[i+1];
+    table[4*i+3]=2.0*(f[i]-f[i+1])+df[i]+df[i+1];
+  }
+  table_invh=1.0/h;
+}
+
+double SwitchingFunction::tableSqr(double distance2,double&dfunc)const {
+  if(distance2>=dmax_2) {
+    dfunc=0.0;
+    return 0.0;
+  }
+  const double x=distance2*table_invh;
+  const unsigned n=table.size()/4;
+  unsigned i=static_cast<unsigned>(x);
+  if(i>=n) i=n-1;
+  const double t=x-i;
+  const double* c=&table[4*i];
+  dfunc=2.0*table_invh*(c[1]+t*(2.0*c[2]+t*3.0*c[3]));
+  return c[0]+t*(c[1]+t*(c[2]+t*c[3]));
 }
 
 std::string SwitchingFunction::description() const {
@@ -351,6 +407,7 @@ std::string SwitchingFunction::description() const {
     ostr<<" func="<<lepton_func;
 
   }
+  if(!table.empty()) ostr<<" tabulated with "<<table.size()/4<<" intervals";
   return ostr.str();
 }
 
@@ -364,7 +421,7 @@ double SwitchingFunction::do_rational(double rdist,double&dfunc,int nn,int mm)co
     result = iden;
   } else {
     if(rdist>(1.-100.0*epsilon) && rdist<(1+100.0*epsilon)) {
-      result=nn/mm;
+      result=double(nn)/mm;
       dfunc=0.5*nn*(nn-mm)/mm;
     } else {
       double rNdist=Tools::fastpow(rdist,nn-1);
@@ -379,8 +436,128 @@ double SwitchingFunction::do_rational(double rdist,double&dfunc,int nn,int mm)co
   return result;
 }
 
+template<int N,int M>
+double SwitchingFunction::rationalT(double rdist,double&dfunc) {
+  if(2*N==M) {
+// if 2*N==M, then (1.0-rdist^N)/(1.0-rdist^M) = 1.0/(1.0+rdist^N)
+    const double rNdist=Tools::fastpow<N-1>(rdist);
+    const double iden=1.0/(1+rNdist*rdist);
+    dfunc = -N*rNdist*iden*iden;
+    return iden;
+  }
+  const double rNdist=Tools::fastpow<N-1>(rdist);
+  const double rMdist=Tools::fastpow<M-1>(rdist);
+  const double num = 1.-rNdist*rdist;
+  const double iden = 1./(1.-rMdist*rdist);
+  double func = num*iden;
+  dfunc = ((-N*rNdist*iden)+(func*(iden*M)*rMdist));
+// the limit for rdist=1 is written as a selection rather than as a branch
+// so that loops calling this function can be vectorized
+  const bool one=(rdist>(1.-100.0*epsilon)) & (rdist<(1+100.0*epsilon));
+  if(one) {
+    func=double(N)/M;
+    dfunc=0.5*N*(N-M)/M;
+  }
+  return func;
+}
+
+template<int N,int M,bool D0Zero,bool Squared>
+void SwitchingFunction::rationalKernel(const SwitchingFunction&sf,unsigned n,const double*x,double*result,double*dfunc) {
+// local copies, so that the compiler knows they are not modified when writing the results
+  const double d0=sf.d0;
+  const double invr0=sf.invr0;
+  const double dmax=sf.dmax;
+  const double stretch=sf.stretch;
+  const double shift=sf.shift;
+  for(unsigned i=0; i<n; i++) {
+    const double distance=(Squared?std::sqrt(x[i]):x[i]);
+    const double rdist=(D0Zero?distance:distance-d0)*invr0;
+    double df;
+    double f=rationalT<N,M>(rdist,df);
+// same operations as in calculate()
+    df*=invr0;
+    df/=distance;
+    if(rdist<=0.) {
+      f=1.;
+      df=0.0;
+    }
+    f=f*stretch+shift;
+    df*=stretch;
+    if(distance>dmax) {
+      f=0.0;
+      df=0.0;
+    }
+    result[i]=f;
+    dfunc[i]=df;
+  }
+}
+
+template<int N,int M>
+void SwitchingFunction::fastRationalKernel(const SwitchingFunction&sf,unsigned n,const double*distance2,double*result,double*dfunc) {
+  const double invr0_2=sf.invr0_2;
+  const double dmax_2=sf.dmax_2;
+  const double stretch=sf.stretch;
+  const double shift=sf.shift;
+  for(unsigned i=0; i<n; i++) {
+    const double rdist_2 = distance2[i]*invr0_2;
+    double df;
+    double f=rationalT<N,M>(rdist_2,df);
+// same operations as in calculateSqr()
+    df*=2*invr0_2;
+    f=f*stretch+shift;
+    df*=stretch;
+    if(distance2[i]>dmax_2) {
+      f=0.0;
+      df=0.0;
+    }
+    result[i]=f;
+    dfunc[i]=df;
+  }
+}
+
+template<int N,int M>
+bool SwitchingFunction::selectKernels() {
+  if(nn!=N || mm!=M) return false;
+  if(d0==0.0) {
+    kernel=rationalKernel<N,M,true,false>;
+    kernelSqr=rationalKernel<N,M,true,true>;
+// with even exponents the square root can be avoided
+    if(N%2==0 && M%2==0) kernelSqr=fastRationalKernel<N/2,M/2>;
+  } else {
+    kernel=rationalKernel<N,M,false,false>;
+    kernelSqr=rationalKernel<N,M,false,true>;
+  }
+  return true;
+}
+
+void SwitchingFunction::setupKernels() {
+  kernel=nullptr;
+  kernelSqr=nullptr;
+  if(type!=rational) return;
+// only the most common exponents are compiled, the other ones use the generic implementation
+  selectKernels<6,12>() || selectKernels<8,12>() || selectKernels<4,8>() || selectKernels<8,16>() || selectKernels<10,20>();
+}
+
+void SwitchingFunction::calculate(unsigned n,const double*distance,double*result,double*dfunc)const {
+  plumed_massert(init,"you are trying to use an unset SwitchingFunction");
+  if(kernel && table.empty()) kernel(*this,n,distance,result,dfunc);
+  else for(unsigned i=0; i<n; i++) result[i]=calculate(distance[i],dfunc[i]);
+}
+
+void SwitchingFunction::calculateSqr(unsigned n,const double*distance2,double*result,double*dfunc)const {
+  plumed_massert(init,"you are trying to use an unset SwitchingFunction");
+  if(kernelSqr && table.empty()) kernelSqr(*this,n,distance2,result,dfunc);
+  else for(unsigned i=0; i<n; i++) result[i]=calculateSqr(distance2[i],dfunc[i]);
+}
+
 double SwitchingFunction::calculateSqr(double distance2,double&dfunc)const {
-  if(fastrational) {
+  if(!table.empty()) {
+    return tableSqr(distance2,dfunc);
+  } else if(kernelSqr) {
+    double result;
+    kernelSqr(*this,1,&distance2,&result,&dfunc);
+    return result;
+  } else if(fastrational) {
     if(distance2>dmax_2) {
       dfunc=0.0;
       return 0.0;
@@ -425,9 +602,14 @@ double SwitchingFunction::calculate(double distance,double&dfunc)const {
   }
 // in this case, the lepton object stores only the calculateSqr function
 // so we have to implement calculate in terms of calculateSqr
-  if(leptonx2) {
+  if(leptonx2 || !table.empty()) {
     return calculateSqr(distance*distance,dfunc);
   }
+  if(kernel) {
+    double result;
+    kernel(*this,1,&distance,&result,&dfunc);
+    return result;
+  }
   const double rdist = (distance-d0)*invr0;
   double result;
 
@@ -484,7 +666,10 @@ double SwitchingFunction::calculate(double distance,double&dfunc)const {
 
 void SwitchingFunction::set(int nn,int mm,double r0,double d0) {
   init=true;
+  table.clear();
   type=rational;
+  kernel=nullptr;
+  kernelSqr=nullptr;
   if(mm==0) mm=2*nn;
   this->nn=nn;
   this->mm=mm;
@@ -501,12 +686,17 @@ void SwitchingFunction::set(int nn,int mm,double r0,double d0) {
   double sd=calculate(dmax,dummy);
   stretch=1.0/(s0-sd);
   shift=-sd*stretch;
+  setupKernels();
 }
 
 double SwitchingFunction::get_r0() const {
   return 1./invr0;
 }
 
+unsigned SwitchingFunction::get_table_size() const {
+  return table.size()/4;
+}
+
 double SwitchingFunction::get_d0() const {
   return d0;
 }
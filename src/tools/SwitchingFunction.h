@@ -87,6 +87,37 @@ class SwitchingFunction {
   bool fastrational=false;
 /// Set to true if lepton only uses x2
   bool leptonx2=false;
+/// Coefficients of the cubic polynomials interpolating the function in each interval of x**2.
+/// Empty unless the TABLE option is used
+  std::vector<double> table;
+/// Inverse of the width of the intervals in x**2
+  double table_invh=0.0;
+/// Fill the table with the given number of intervals
+  void setupTable(unsigned n);
+/// Compute the function from the table, same conventions as calculateSqr()
+  double tableSqr(double distance2,double&dfunc)const;
+/// Signature of the kernels computing the function on a batch of n (squared) distances
+  typedef void (*Kernel)(const SwitchingFunction&,unsigned n,const double*x,double*result,double*dfunc);
+/// Kernel used by calculate() for rational functions with the most common exponents.
+/// It is selected once in set() and is null for all other functions
+  Kernel kernel=nullptr;
+/// Kernel used by calculateSqr(), same as above
+  Kernel kernelSqr=nullptr;
+/// Rational function with exponents fixed at compile time, same as do_rational()
+  template<int N,int M>
+  static double rationalT(double rdist,double&dfunc);
+/// Kernel for rational functions computed on distances (or on squared distances if Squared is true)
+  template<int N,int M,bool D0Zero,bool Squared>
+  static void rationalKernel(const SwitchingFunction&,unsigned n,const double*x,double*result,double*dfunc);
+/// Kernel for fast rational functions, computed directly on squared distances.
+/// N and M here are half of the exponents
+  template<int N,int M>
+  static void fastRationalKernel(const SwitchingFunction&,unsigned n,const double*distance2,double*result,double*dfunc);
+/// Select the kernels if exponents are N and M. Returns false otherwise
+  template<int N,int M>
+  bool selectKernels();
+/// Select the kernels, to be called at the end of set()
+  void setupKernels();
 public:
   static void registerKeywords( Keywords& keys );
 /// Set a "rational" switching function.
@@ -110,6 +141,16 @@ public:
 /// The advantage is that in some case the expensive square root can be avoided
 /// (namely for rational functions, if nn and mm are even and d0 is zero)
   double calculateSqr(double distance2,double&dfunc)const;
+/// Compute the switching function on n distances.
+/// Same as calling calculate() on each of them, but avoids dispatching
+/// on the function type for every distance
+  void calculate(unsigned n,const double*distance,double*result,double*dfunc)const;
+/// Compute the switching function on n squared distances.
+/// Same as calling calculateSqr() on each of them, but avoids dispatching
+/// on the function type for every distance
+  void calculateSqr(unsigned n,const double*distance2,double*result,double*dfunc)const;
+/// Returns the number of intervals used to tabulate the function, or zero if it is not tabulated
+  unsigned get_table_size() const;
 /// Returns d0
   double get_d0() const;
 /// Returns r0
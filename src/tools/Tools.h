@@ -133,6 +133,11 @@ public:
   static std::string extension(const std::string&);
 /// Fast int power
   static double fastpow(double base,int exp);
+/// Fast int power with exponent known at compile time.
+/// Performs the same multiplications as fastpow(double,int), so that results are identical,
+/// but the loop is fully unrolled by the compiler
+  template<int exp>
+  static double fastpow(double base);
 /// Modified 0th-order Bessel function of the first kind
   static double bessel0(const double& val);
 /// Check if a string full starts with string start.
@@ -249,6 +254,19 @@ void Tools::convert(T i,std::string & str) {
   str=ostr.str();
 }
 
+template<int exp>
+inline
+double Tools::fastpow(double base) {
+  static_assert(exp>=0,"fastpow with compile-time exponent only accepts non-negative exponents");
+  double result = 1.0;
+  for(int e=exp; e; e>>=1) {
+    if (e & 1)
+      result *= base;
+    base *= base;
+  }
+  return result;
+}
+
 inline
 double Tools::fastpow(double base, int exp)
 {
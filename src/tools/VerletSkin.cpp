@@ -0,0 +1,103 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2018 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "VerletSkin.h"
+#include "Pbc.h"
+#include <ostream>
+#include <cmath>
+
+namespace PLMD {
+
+VerletSkin::VerletSkin(double s):
+  skin(s),
+  forced(true),
+  lastDisplacement(0.0),
+  nchecks(0),
+  nupdates(0),
+  nviolations(0)
+{
+}
+
+void VerletSkin::setSkin(double s) {
+  skin=s;
+}
+
+void VerletSkin::invalidate() {
+  forced=true;
+}
+
+double VerletSkin::displacement(const std::vector<Vector>&pos,const Pbc*pbc)const {
+  double max1=0.0,max2=0.0;
+  for(unsigned i=0; i<pos.size(); i++) {
+    Vector d;
+    if(pbc) d=pbc->distance(reference[i],pos[i]);
+    else d=delta(reference[i],pos[i]);
+    const double d2=modulo2(d);
+    if(d2>max1) {
+      max2=max1;
+      max1=d2;
+    } else if(d2>max2) max2=d2;
+  }
+  return std::sqrt(max1)+std::sqrt(max2);
+}
+
+void VerletSkin::update(const std::vector<Vector>&pos) {
+  reference=pos;
+  forced=false;
+  lastDisplacement=0.0;
+  nupdates++;
+}
+
+bool VerletSkin::needsUpdate(const std::vector<Vector>&pos,const Pbc*pbc) {
+  nchecks++;
+  if(forced || reference.size()!=pos.size()) {
+    update(pos);
+    return true;
+  }
+  lastDisplacement=displacement(pos,pbc);
+  if(lastDisplacement>skin) {
+    update(pos);
+    return true;
+  }
+  return false;
+}
+
+bool VerletSkin::scheduledUpdate(bool scheduled,const std::vector<Vector>&pos,const Pbc*pbc) {
+  nchecks++;
+  if(scheduled || forced || reference.size()!=pos.size()) {
+    update(pos);
+    return true;
+  }
+  if(skin>0.0) {
+    lastDisplacement=displacement(pos,pbc);
+    if(lastDisplacement>skin) nviolations++;
+  }
+  return false;
+}
+
+std::ostream& operator<<(std::ostream&os,const VerletSkin&v) {
+  os<<"  neighbor list updated "<<v.nupdates<<" times in "<<v.nchecks<<" steps";
+  if(v.skin>0.0) os<<", skin "<<v.skin<<" exceeded in "<<v.nviolations<<" steps";
+  os<<"\n";
+  return os;
+}
+
+}
@@ -0,0 +1,107 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2018 The plumed team
+   (see the PEOPLE file at the root of the distribution for a list of names)
+
+   See http://www.plumed.org for more information.
+
+   This file is part of plumed, version 2.
+
+   plumed is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   plumed is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with plumed.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_tools_VerletSkin_h
+#define __PLUMED_tools_VerletSkin_h
+
+#include "Vector.h"
+#include <vector>
+#include <iosfwd>
+
+namespace PLMD {
+
+class Pbc;
+
+/// \ingroup TOOLBOX
+/// Decide when a neighbor list should be rebuilt based on atomic displacements.
+///
+/// A neighbor list built with a cutoff equal to the interaction cutoff plus a skin
+/// remains valid as long as the sum of the two largest atomic displacements
+/// since the last update is smaller than the skin.
+/// This class stores the positions used for the last update and can be used in two ways:
+/// - with needsUpdate(), the list is rebuilt only when displacements exceed the skin;
+/// - with scheduledUpdate(), the list is rebuilt at fixed steps decided by the caller,
+///   and displacements are only used to count the steps in which the list was not valid anymore
+///   (skin violations).
+///
+/// Statistics can be written with operator<<.
+class VerletSkin {
+  double skin;
+  bool forced;
+  std::vector<Vector> reference;
+  double lastDisplacement;
+  unsigned long nchecks,nupdates,nviolations;
+/// Sum of the two largest displacements since the last update, computed with pbc if pbc is not nullptr
+  double displacement(const std::vector<Vector>&pos,const Pbc*pbc)const;
+/// Store positions at update
+  void update(const std::vector<Vector>&pos);
+public:
+  explicit VerletSkin(double skin=0.0);
+/// Set the skin
+  void setSkin(double);
+/// Get the skin
+  double getSkin()const;
+/// Force an update at the next check (e.g. on exchange steps)
+  void invalidate();
+/// Check positions and return true if the list should be rebuilt
+  bool needsUpdate(const std::vector<Vector>&pos,const Pbc*pbc);
+/// Return true if the list should be rebuilt, which is the case if scheduled is true or if an update has been forced.
+/// If the skin is positive, displacements are also computed to count violations
+  bool scheduledUpdate(bool scheduled,const std::vector<Vector>&pos,const Pbc*pbc);
+/// Sum of the two largest displacements computed at the last check
+  double getLastDisplacement()const;
+/// Number of checks
+  unsigned long getChecks()const;
+/// Number of updates
+  unsigned long getUpdates()const;
+/// Number of checks in which the list was used although displacements exceeded the skin
+  unsigned long getViolations()const;
+  friend std::ostream& operator<<(std::ostream&,const VerletSkin&);
+};
+
+inline
+double VerletSkin::getSkin()const {
+  return skin;
+}
+
+inline
+double VerletSkin::getLastDisplacement()const {
+  return lastDisplacement;
+}
+
+inline
+unsigned long VerletSkin::getChecks()const {
+  return nchecks;
+}
+
+inline
+unsigned long VerletSkin::getUpdates()const {
+  return nupdates;
+}
+
+inline
+unsigned long VerletSkin::getViolations()const {
+  return nviolations;
+}
+
+}
+
+#endif
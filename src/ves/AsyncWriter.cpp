@@ -0,0 +1,120 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2016-2018 The VES code team
+   (see the PEOPLE-VES file at the root of this folder for a list of names)
+
+   See http://www.ves-code.org for more information.
+
+   This file is part of VES code module.
+
+   The VES code module is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   The VES code module is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with the VES code module.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#include "AsyncWriter.h"
+
+#include "tools/Exception.h"
+
+#include <cstdio>
+#include <system_error>
+
+
+namespace PLMD {
+namespace ves {
+
+
+AsyncWriter::AsyncWriter(const unsigned int max_queued):
+  max_queued_(max_queued),
+  busy_(false),
+  stop_(false)
+{
+  plumed_massert(max_queued_>0,"the maximum number of queued output tasks should be larger than zero");
+  try {
+    worker_ = std::thread(&AsyncWriter::run,this);
+  }
+  catch(const std::system_error&) {
+    // the tasks are run directly by submit()
+  }
+}
+
+
+AsyncWriter::~AsyncWriter() {
+  if(!worker_.joinable()) {return;}
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_=true;
+  }
+  cond_.notify_all();
+  worker_.join();
+  if(error_) {
+    try {std::rethrow_exception(error_);}
+    catch(std::exception& e) {std::fprintf(stderr,"PLUMED: error in writing output files in the background: %s\n",e.what());}
+    catch(...) {std::fprintf(stderr,"PLUMED: error in writing output files in the background\n");}
+  }
+}
+
+
+void AsyncWriter::submit(const std::function<void()>& task) {
+  if(!worker_.joinable()) {
+    task();
+    return;
+  }
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock,[this] {return queue_.size()<max_queued_ || error_;});
+    rethrowError();
+    queue_.push_back(task);
+  }
+  cond_.notify_all();
+}
+
+
+void AsyncWriter::flush() {
+  if(!worker_.joinable()) {return;}
+  std::unique_lock<std::mutex> lock(mutex_);
+  cond_.wait(lock,[this] {return (queue_.empty() && !busy_) || error_;});
+  rethrowError();
+}
+
+
+void AsyncWriter::rethrowError() {
+  // should be called with the mutex locked
+  if(error_) {
+    std::exception_ptr e=error_;
+    error_=nullptr;
+    queue_.clear();
+    std::rethrow_exception(e);
+  }
+}
+
+
+void AsyncWriter::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while(true) {
+    cond_.wait(lock,[this] {return !queue_.empty() || stop_;});
+    if(queue_.empty()) {break;}
+    std::function<void()> task=queue_.front();
+    queue_.pop_front();
+    busy_=true;
+    lock.unlock();
+    std::exception_ptr e;
+    try {task();}
+    catch(...) {e=std::current_exception();}
+    lock.lock();
+    busy_=false;
+    if(e && !error_) {error_=e;}
+    cond_.notify_all();
+  }
+}
+
+
+}
+}
@@ -0,0 +1,76 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2016-2018 The VES code team
+   (see the PEOPLE-VES file at the root of this folder for a list of names)
+
+   See http://www.ves-code.org for more information.
+
+   This file is part of VES code module.
+
+   The VES code module is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   The VES code module is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with the VES code module.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+#ifndef __PLUMED_ves_AsyncWriter_h
+#define __PLUMED_ves_AsyncWriter_h
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+
+namespace PLMD {
+namespace ves {
+
+/*
+Runs output tasks in order on a single background thread.
+
+The tasks are queued with submit(), which waits if max_queued tasks are
+already waiting. A task must only use data that it owns (e.g. copies of the
+coefficients or grids) and files that are not linked to an MPI communicator,
+as the MPI calls done by linked files are not allowed outside the main thread.
+An exception thrown by a task is rethrown by the next call to submit() or flush().
+If the thread cannot be started (e.g. the thread library is not linked)
+the tasks are run directly by submit().
+*/
+
+class AsyncWriter {
+private:
+  unsigned int max_queued_;
+  std::deque<std::function<void()> > queue_;
+  bool busy_;
+  bool stop_;
+  std::exception_ptr error_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::thread worker_;
+  //
+  void run();
+  void rethrowError();
+  AsyncWriter(const AsyncWriter&);
+  AsyncWriter& operator=(const AsyncWriter&);
+public:
+  explicit AsyncWriter(const unsigned int max_queued=4);
+  // waits for all the queued tasks to be finished
+  ~AsyncWriter();
+  void submit(const std::function<void()>&);
+  void flush();
+  bool isThreaded() const {return worker_.joinable();}
+};
+
+
+}
+}
+
+#endif
@@ -93,6 +93,7 @@ public:
   static void registerKeywords(Keywords&);
   explicit BF_Chebyshev(const ActionOptions&);
   void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
+  void getAllValuesBatch(const std::vector<double>&, std::vector<double>&, std::vector<bool>&, std::vector<double>&, std::vector<double>&) const;
   double getInnerProductWeight(const double arg) const;
   std::string getInnerProductWeightStr() const {return "1/sqrt(1-x^2)";}
 };
@@ -126,23 +127,63 @@ void BF_Chebyshev::getAllValues(const double arg, double& argT, bool& inside_ran
   // plumed_assert(derivs.size()==numberOfBasisFunctions());
   inside_range=true;
   argT=translateArgument(arg, inside_range);
-  std::vector<double> derivsT(derivs.size());
   //
+  // derivatives with respect to argT of the two previous polynomials
+  double derivsT_prev=0.0;
+  double derivsT_curr=1.0;
   values[0]=1.0;
-  derivsT[0]=0.0;
   derivs[0]=0.0;
   values[1]=argT;
-  derivsT[1]=1.0;
   derivs[1]=intervalDerivf();
   for(unsigned int i=1; i < getOrder(); i++) {
     values[i+1]  = 2.0*argT*values[i]-values[i-1];
-    derivsT[i+1] = 2.0*values[i]+2.0*argT*derivsT[i]-derivsT[i-1];
-    derivs[i+1]  = intervalDerivf()*derivsT[i+1];
+    double derivsT_next = 2.0*values[i]+2.0*argT*derivsT_curr-derivsT_prev;
+    derivs[i+1]  = intervalDerivf()*derivsT_next;
+    derivsT_prev = derivsT_curr;
+    derivsT_curr = derivsT_next;
   }
   if(!inside_range) {for(unsigned int i=0; i<derivs.size(); i++) {derivs[i]=0.0;}}
 }
 
 
+void BF_Chebyshev::getAllValuesBatch(const std::vector<double>& args, std::vector<double>& argsT, std::vector<bool>& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
+  const size_t np = args.size();
+  argsT.resize(np);
+  inside_range.resize(np);
+  values.resize(numberOfBasisFunctions()*np);
+  derivs.resize(numberOfBasisFunctions()*np);
+  for(size_t p=0; p<np; p++) {
+    bool inside=true;
+    argsT[p]=translateArgument(args[p],inside);
+    inside_range[p]=inside;
+  }
+  // the recurrence is done for all the arguments at once, the derivatives
+  // are first obtained with respect to argT and then scaled
+  const double* x = argsT.data();
+  double* v = values.data();
+  double* d = derivs.data();
+  for(size_t p=0; p<np; p++) {
+    v[p]=1.0; d[p]=0.0;
+    v[np+p]=x[p]; d[np+p]=1.0;
+  }
+  for(unsigned int i=1; i < getOrder(); i++) {
+    const double* v_curr = v+i*np;
+    const double* v_prev = v+(i-1)*np;
+    const double* d_curr = d+i*np;
+    const double* d_prev = d+(i-1)*np;
+    double* v_next = v+(i+1)*np;
+    double* d_next = d+(i+1)*np;
+    for(size_t p=0; p<np; p++) {
+      v_next[p] = 2.0*x[p]*v_curr[p]-v_prev[p];
+      d_next[p] = 2.0*v_curr[p]+2.0*x[p]*d_curr[p]-d_prev[p];
+    }
+  }
+  const double derivf = intervalDerivf();
+  for(size_t k=np; k<numberOfBasisFunctions()*np; k++) {d[k]*=derivf;}
+  setDerivsOutsideRangeToZero(inside_range,derivs);
+}
+
+
 void BF_Chebyshev::setupUniformIntegrals() {
   for(unsigned int i=0; i<numberOfBasisFunctions(); i++) {
     double io = i;
@@ -48,6 +48,7 @@ public:
   static void registerKeywords( Keywords&);
   explicit BF_CubicBspline(const ActionOptions&);
   void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
+  void getAllValuesBatch(const std::vector<double>&, std::vector<double>&, std::vector<bool>&, std::vector<double>&, std::vector<double>&) const;
 };
 
 
@@ -103,6 +104,38 @@ void BF_CubicBspline::getAllValues(const double arg, double& argT, bool& inside_
 }
 
 
+void BF_CubicBspline::getAllValuesBatch(const std::vector<double>& args, std::vector<double>& argsT, std::vector<bool>& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
+  const size_t np = args.size();
+  argsT.resize(np);
+  inside_range.resize(np);
+  values.resize(numberOfBasisFunctions()*np);
+  derivs.resize(numberOfBasisFunctions()*np);
+  for(size_t p=0; p<np; p++) {
+    bool inside=true;
+    argsT[p]=checkIfArgumentInsideInterval(args[p],inside);
+    inside_range[p]=inside;
+  }
+  const double* x = argsT.data();
+  double* v = values.data();
+  double* d = derivs.data();
+  for(size_t p=0; p<np; p++) {
+    v[p]=1.0;
+    d[p]=0.0;
+  }
+  for(unsigned int i=1; i < getNumberOfBasisFunctions(); i++) {
+    const double shift = static_cast<double>(i)-2.0;
+    double* v_curr = v+i*np;
+    double* d_curr = d+i*np;
+    for(size_t p=0; p<np; p++) {
+      double argx = ((x[p]-intervalMin())*inv_spacing_) - shift;
+      v_curr[p] = spline(argx, d_curr[p]);
+      d_curr[p] *= inv_spacing_;
+    }
+  }
+  setDerivsOutsideRangeToZero(inside_range,derivs);
+}
+
+
 double BF_CubicBspline::spline(const double arg, double& deriv) const {
   double value=0.0;
   double x=arg;
@@ -89,6 +89,7 @@ public:
   static void registerKeywords(Keywords&);
   explicit BF_Fourier(const ActionOptions&);
   void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
+  void getAllValuesBatch(const std::vector<double>&, std::vector<double>&, std::vector<bool>&, std::vector<double>&, std::vector<double>&) const;
 };
 
 
@@ -137,6 +138,44 @@ void BF_Fourier::getAllValues(const double arg, double& argT, bool& inside_range
 }
 
 
+void BF_Fourier::getAllValuesBatch(const std::vector<double>& args, std::vector<double>& argsT, std::vector<bool>& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
+  const size_t np = args.size();
+  argsT.resize(np);
+  inside_range.resize(np);
+  values.resize(numberOfBasisFunctions()*np);
+  derivs.resize(numberOfBasisFunctions()*np);
+  for(size_t p=0; p<np; p++) {
+    bool inside=true;
+    argsT[p]=translateArgument(args[p],inside);
+    inside_range[p]=inside;
+  }
+  const double* x = argsT.data();
+  double* v = values.data();
+  double* d = derivs.data();
+  for(size_t p=0; p<np; p++) {
+    v[p]=1.0;
+    d[p]=0.0;
+  }
+  const double derivf = intervalDerivf();
+  for(unsigned int i=1; i < getOrder()+1; i++) {
+    double io = i;
+    double* v_cos = v+(2*i-1)*np;
+    double* d_cos = d+(2*i-1)*np;
+    double* v_sin = v+(2*i)*np;
+    double* d_sin = d+(2*i)*np;
+    for(size_t p=0; p<np; p++) {
+      v_cos[p] = cos(io*x[p]);
+      v_sin[p] = sin(io*x[p]);
+    }
+    for(size_t p=0; p<np; p++) {
+      d_cos[p] = -io*v_sin[p]*derivf;
+      d_sin[p] = io*v_cos[p]*derivf;
+    }
+  }
+  setDerivsOutsideRangeToZero(inside_range,derivs);
+}
+
+
 void BF_Fourier::setupLabels() {
   setLabel(0,"1");
   for(unsigned int i=1; i < getOrder()+1; i++) {
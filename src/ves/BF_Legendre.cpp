@@ -100,6 +100,7 @@ public:
   static void registerKeywords(Keywords&);
   explicit BF_Legendre(const ActionOptions&);
   void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
+  void getAllValuesBatch(const std::vector<double>&, std::vector<double>&, std::vector<bool>&, std::vector<double>&, std::vector<double>&) const;
 };
 
 
@@ -134,19 +135,21 @@ void BF_Legendre::getAllValues(const double arg, double& argT, bool& inside_rang
   // plumed_assert(derivs.size()==numberOfBasisFunctions());
   inside_range=true;
   argT=translateArgument(arg, inside_range);
-  std::vector<double> derivsT(derivs.size());
   //
+  // derivatives with respect to argT of the two previous polynomials
+  double derivsT_prev=0.0;
+  double derivsT_curr=1.0;
   values[0]=1.0;
-  derivsT[0]=0.0;
   derivs[0]=0.0;
   values[1]=argT;
-  derivsT[1]=1.0;
   derivs[1]=intervalDerivf();
   for(unsigned int i=1; i < getOrder(); i++) {
     double io = static_cast<double>(i);
     values[i+1]  = ((2.0*io+1.0)/(io+1.0))*argT*values[i] - (io/(io+1.0))*values[i-1];
-    derivsT[i+1] = ((2.0*io+1.0)/(io+1.0))*(values[i]+argT*derivsT[i])-(io/(io+1.0))*derivsT[i-1];
-    derivs[i+1]  = intervalDerivf()*derivsT[i+1];
+    double derivsT_next = ((2.0*io+1.0)/(io+1.0))*(values[i]+argT*derivsT_curr)-(io/(io+1.0))*derivsT_prev;
+    derivs[i+1]  = intervalDerivf()*derivsT_next;
+    derivsT_prev = derivsT_curr;
+    derivsT_curr = derivsT_next;
   }
   if(scaled_) {
     // L0 is also scaled!
@@ -161,6 +164,58 @@ void BF_Legendre::getAllValues(const double arg, double& argT, bool& inside_rang
 }
 
 
+void BF_Legendre::getAllValuesBatch(const std::vector<double>& args, std::vector<double>& argsT, std::vector<bool>& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
+  const size_t np = args.size();
+  argsT.resize(np);
+  inside_range.resize(np);
+  values.resize(numberOfBasisFunctions()*np);
+  derivs.resize(numberOfBasisFunctions()*np);
+  for(size_t p=0; p<np; p++) {
+    bool inside=true;
+    argsT[p]=translateArgument(args[p],inside);
+    inside_range[p]=inside;
+  }
+  // the recurrence is done for all the arguments at once, the derivatives
+  // are first obtained with respect to argT and then scaled
+  const double* x = argsT.data();
+  double* v = values.data();
+  double* d = derivs.data();
+  for(size_t p=0; p<np; p++) {
+    v[p]=1.0; d[p]=0.0;
+    v[np+p]=x[p]; d[np+p]=1.0;
+  }
+  for(unsigned int i=1; i < getOrder(); i++) {
+    const double io = static_cast<double>(i);
+    const double c1 = (2.0*io+1.0)/(io+1.0);
+    const double c2 = io/(io+1.0);
+    const double* v_curr = v+i*np;
+    const double* v_prev = v+(i-1)*np;
+    const double* d_curr = d+i*np;
+    const double* d_prev = d+(i-1)*np;
+    double* v_next = v+(i+1)*np;
+    double* d_next = d+(i+1)*np;
+    for(size_t p=0; p<np; p++) {
+      v_next[p] = c1*x[p]*v_curr[p] - c2*v_prev[p];
+      d_next[p] = c1*(v_curr[p]+x[p]*d_curr[p])-c2*d_prev[p];
+    }
+  }
+  const double derivf = intervalDerivf();
+  for(size_t k=np; k<numberOfBasisFunctions()*np; k++) {d[k]*=derivf;}
+  if(scaled_) {
+    // L0 is also scaled!
+    for(unsigned int i=0; i<numberOfBasisFunctions(); i++) {
+      double io = static_cast<double>(i);
+      double sf = sqrt(io+0.5);
+      for(size_t p=0; p<np; p++) {
+        v[i*np+p] *= sf;
+        d[i*np+p] *= sf;
+      }
+    }
+  }
+  setDerivsOutsideRangeToZero(inside_range,derivs);
+}
+
+
 void BF_Legendre::setupUniformIntegrals() {
   setAllUniformIntegralsToZero();
   double L0_int = 1.0;
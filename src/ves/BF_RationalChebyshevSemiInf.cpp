@@ -85,18 +85,19 @@ void BF_RationalChebyshevSemiInf::getAllValues(const double arg, double& argT, b
   double derivf = (2.0*mapf_)/((argT+mapf_)*(argT+mapf_));
   argT = (argT-mapf_)/(argT+mapf_);
   //
-  std::vector<double> derivsT(derivs.size());
-  //
+  // derivatives with respect to argT of the two previous polynomials
+  double derivsT_prev=0.0;
+  double derivsT_curr=1.0;
   values[0]=1.0;
-  derivsT[0]=0.0;
   derivs[0]=0.0;
   values[1]=argT;
-  derivsT[1]=1.0;
   derivs[1]=derivf;
   for(unsigned int i=1; i < getOrder(); i++) {
     values[i+1]  = 2.0*argT*values[i]-values[i-1];
-    derivsT[i+1] = 2.0*values[i]+2.0*argT*derivsT[i]-derivsT[i-1];
-    derivs[i+1]  = derivf*derivsT[i+1];
+    double derivsT_next = 2.0*values[i]+2.0*argT*derivsT_curr-derivsT_prev;
+    derivs[i+1]  = derivf*derivsT_next;
+    derivsT_prev = derivsT_curr;
+    derivsT_curr = derivsT_next;
   }
   if(!inside_range) {for(unsigned int i=0; i<derivs.size(); i++) {derivs[i]=0.0;}}
 }
@@ -164,6 +164,7 @@ void BasisFunctions::setupInterval() {
   interval_range_ = interval_max_-interval_min_;
   interval_mean_  = 0.5*(interval_max_+interval_min_);
   argT_derivf_ = interval_intrinsic_range_/interval_range_;
+  clearGridAxisTables();
 }
 
 
@@ -273,16 +274,12 @@ std::vector<double> BasisFunctions::numericalTargetDistributionIntegralsFromGrid
   //
   std::vector<double> targetdist_integrals(nbasis_,0.0);
   std::vector<double> integration_weights = GridIntegrationWeights::getIntegrationWeights(grid_pntr);
+  const std::vector<double>& bf_values = getAllValuesOnGridAxis(grid_pntr,0);
 
   for(Grid::index_t k=0; k < grid_pntr->getSize(); k++) {
-    double arg = grid_pntr->getPoint(k)[0];
-    std::vector<double> bf_values(nbasis_);
-    std::vector<double> bf_derivs(nbasis_);
-    bool inside=true;
-    double argT=0.0;
-    getAllValues(arg,argT,inside,bf_values,bf_derivs);
+    const double weight = integration_weights[k] * grid_pntr->getValue(k);
     for(unsigned int i=0; i < nbasis_; i++) {
-      targetdist_integrals[i] += (integration_weights[k] * grid_pntr->getValue(k)) * bf_values[i];
+      targetdist_integrals[i] += weight * bf_values[k*nbasis_+i];
     }
   }
   // assume that the first function is the constant
@@ -293,6 +290,48 @@ std::vector<double> BasisFunctions::numericalTargetDistributionIntegralsFromGrid
 }
 
 
+const BasisFunctions::GridAxisTable& BasisFunctions::getGridAxisTable(const Grid* grid_pntr, const unsigned int axis) const {
+  plumed_massert(grid_pntr!=NULL,"the grid is not defined");
+  plumed_massert(axis<grid_pntr->getDimension(),"the grid axis is out of range");
+  std::vector<unsigned> indices(grid_pntr->getDimension(),0);
+  std::vector<double> point(grid_pntr->getDimension());
+  grid_pntr->getPoint(indices,point);
+  const double min = point[axis];
+  const double dx = grid_pntr->getDx()[axis];
+  const unsigned int npoints = grid_pntr->getNbin()[axis];
+  for(unsigned int i=0; i<grid_axis_tables_.size(); i++) {
+    const GridAxisTable& table = *grid_axis_tables_[i];
+    if(table.min==min && table.dx==dx && table.npoints==npoints) {return table;}
+  }
+  //
+  std::unique_ptr<GridAxisTable> table(new GridAxisTable);
+  table->min = min;
+  table->dx = dx;
+  table->npoints = npoints;
+  table->values.assign(npoints*nbasis_,0.0);
+  table->derivs.assign(npoints*nbasis_,0.0);
+  std::vector<double> args(npoints);
+  for(unsigned int b=0; b<npoints; b++) {
+    indices[axis]=b;
+    grid_pntr->getPoint(indices,point);
+    args[b]=point[axis];
+  }
+  std::vector<double> argsT;
+  std::vector<bool> inside;
+  std::vector<double> values;
+  std::vector<double> derivs;
+  getAllValuesBatch(args,argsT,inside,values,derivs);
+  for(unsigned int b=0; b<npoints; b++) {
+    for(unsigned int i=0; i<nbasis_; i++) {
+      table->values[b*nbasis_+i]=values[i*npoints+b];
+      table->derivs[b*nbasis_+i]=derivs[i*npoints+b];
+    }
+  }
+  grid_axis_tables_.push_back(std::move(table));
+  return *grid_axis_tables_.back();
+}
+
+
 std::vector<double> BasisFunctions::getTargetDistributionIntegrals(const TargetDistribution* targetdist_pntr) const {
   if(targetdist_pntr==NULL) {
     return getUniformIntegrals();
@@ -321,6 +360,26 @@ double BasisFunctions::getValue(const double arg, const unsigned int n, double&
 }
 
 
+void BasisFunctions::getAllValuesBatch(const std::vector<double>& args, std::vector<double>& argsT, std::vector<bool>& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
+  const size_t npoints = args.size();
+  argsT.resize(npoints);
+  inside_range.resize(npoints);
+  values.resize(nbasis_*npoints);
+  derivs.resize(nbasis_*npoints);
+  std::vector<double> values_tmp(nbasis_);
+  std::vector<double> derivs_tmp(nbasis_);
+  for(size_t p=0; p<npoints; p++) {
+    bool inside=true;
+    getAllValues(args[p],argsT[p],inside,values_tmp,derivs_tmp);
+    inside_range[p]=inside;
+    for(unsigned int i=0; i<nbasis_; i++) {
+      values[i*npoints+p]=values_tmp[i];
+      derivs[i*npoints+p]=derivs_tmp[i];
+    }
+  }
+}
+
+
 void BasisFunctions::getAllValuesNumericalDerivs(const double arg, double& argT, bool& inside_range, std::vector<double>& values, std::vector<double>& derivs) const {
   // use forward difference, unless very close to the boundary
   double delta = sqrt(epsilon);
@@ -342,15 +401,27 @@ void BasisFunctions::getMultipleValue(const std::vector<double>& args, std::vect
   argsT.resize(args.size());
   values.clear();
   derivs.clear();
+  if(!numerical_deriv) {
+    const size_t npoints = args.size();
+    std::vector<bool> inside_interval;
+    std::vector<double> batch_values;
+    std::vector<double> batch_derivs;
+    getAllValuesBatch(args,argsT,inside_interval,batch_values,batch_derivs);
+    values.assign(npoints,std::vector<double>(getNumberOfBasisFunctions()));
+    derivs.assign(npoints,std::vector<double>(getNumberOfBasisFunctions()));
+    for(size_t p=0; p<npoints; p++) {
+      for(unsigned int i=0; i<getNumberOfBasisFunctions(); i++) {
+        values[p][i]=batch_values[i*npoints+p];
+        derivs[p][i]=batch_derivs[i*npoints+p];
+      }
+    }
+    return;
+  }
   for(unsigned int i=0; i<args.size(); i++) {
     std::vector<double> tmp_values(getNumberOfBasisFunctions());
     std::vector<double> tmp_derivs(getNumberOfBasisFunctions());
     bool inside_interval=true;
-    if(!numerical_deriv) {
-      getAllValues(args[i],argsT[i],inside_interval,tmp_values,tmp_derivs);
-    } else {
-      getAllValuesNumericalDerivs(args[i],argsT[i],inside_interval,tmp_values,tmp_derivs);
-    }
+    getAllValuesNumericalDerivs(args[i],argsT[i],inside_interval,tmp_values,tmp_derivs);
     values.push_back(tmp_values);
     derivs.push_back(tmp_derivs);
   }
@@ -27,6 +27,7 @@
 #include <vector>
 #include <string>
 #include <cmath>
+#include <memory>
 
 
 #define PLUMED_VES_BASISFUNCTIONS_INIT(ao) BasisFunctions(ao)
@@ -98,7 +99,19 @@ private:
   //
   VesBias* vesbias_pntr_;
   Action* action_pntr_;
+  // the values and derivatives of the basis functions on the points along
+  // a grid axis, cached as they only change if the interval is changed
+  struct GridAxisTable {
+    double min;
+    double dx;
+    unsigned int npoints;
+    std::vector<double> values;
+    std::vector<double> derivs;
+  };
+  mutable std::vector<std::unique_ptr<GridAxisTable> > grid_axis_tables_;
   //
+  const GridAxisTable& getGridAxisTable(const Grid*, const unsigned int) const;
+  void clearGridAxisTables() {grid_axis_tables_.clear();}
   void getAllValuesNumericalDerivs(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const;
 
 protected:
@@ -110,6 +123,8 @@ protected:
   std::vector<double> numericalTargetDistributionIntegralsFromGrid(const Grid*) const ;
   virtual void setupLabels();
   virtual void setupUniformIntegrals();
+  // used by getAllValuesBatch for the derivatives of the arguments outside the interval
+  void setDerivsOutsideRangeToZero(const std::vector<bool>&, std::vector<double>&) const;
   template<typename T>
   void addKeywordToList(const std::string&, const T);
   template<typename T>
@@ -188,9 +203,20 @@ public:
   double getValue(const double, const unsigned int, double&, bool&) const;
   // calcuate the values for all basis functions
   virtual void getAllValues(const double, double&, bool&, std::vector<double>&, std::vector<double>&) const = 0;
+  // calculate the values for all basis functions for many arguments at once,
+  // the value of the n-th basis function for the p-th argument is stored at
+  // [n*args.size()+p] such that the loops over the arguments can be vectorized.
+  // The default implementation calls getAllValues for each argument.
+  virtual void getAllValuesBatch(const std::vector<double>&, std::vector<double>&, std::vector<bool>&, std::vector<double>&, std::vector<double>&) const;
   //virtual void get2ndDerivatives(const double, std::vector<double>&)=0;
   void printInfo() const;
   //
+  // values and derivatives of all basis functions on the points along one axis
+  // of a grid, the value of the n-th basis function for the b-th point is at
+  // [b*getNumberOfBasisFunctions()+n]. Not thread safe.
+  const std::vector<double>& getAllValuesOnGridAxis(const Grid* grid_pntr, const unsigned int axis) const {return getGridAxisTable(grid_pntr,axis).values;}
+  const std::vector<double>& getAllDerivsOnGridAxis(const Grid* grid_pntr, const unsigned int axis) const {return getGridAxisTable(grid_pntr,axis).derivs;}
+  //
   void getMultipleValue(const std::vector<double>&, std::vector<double>&, std::vector<std::vector<double> >&, std::vector<std::vector<double> >&, const bool numerical_deriv=false) const;
   void writeBasisFunctionsToFile(OFile&, OFile&, const std::string& min_in, const std::string& max_in, unsigned int nbins=1000, const bool ignore_periodicity=false, const std::string& output_fmt="%15.8f", const bool numerical_deriv=false) const;
 
@@ -208,11 +234,23 @@ public:
 inline
 void BasisFunctions::setNumberOfBasisFunctions(const unsigned int nbasis_in) {
   nbasis_=nbasis_in;
+  clearGridAxisTables();
   bf_labels_.assign(nbasis_,"");
   uniform_integrals_.assign(nbasis_,0.0);
 }
 
 
+inline
+void BasisFunctions::setDerivsOutsideRangeToZero(const std::vector<bool>& inside_range, std::vector<double>& derivs) const {
+  const size_t npoints = inside_range.size();
+  for(size_t p=0; p<npoints; p++) {
+    if(!inside_range[p]) {
+      for(unsigned int i=0; i<nbasis_; i++) {derivs[i*npoints+p]=0.0;}
+    }
+  }
+}
+
+
 inline
 VesBias* BasisFunctions::getPntrToVesBias() const {
   plumed_massert(vesbias_pntr_!=NULL,"the VES bias has not been linked");
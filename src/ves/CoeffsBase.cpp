@@ -314,6 +314,22 @@ void CoeffsBase::setType(const CoeffsType coeffs_type) {
 }
 
 
+void CoeffsBase::setTypeFromString(const std::string& coeffs_type_str) {
+  if(coeffs_type_str=="Generic") {
+    coeffs_type_ = Generic;
+  }
+  else if(coeffs_type_str=="LinearBasisSet") {
+    coeffs_type_ = LinearBasisSet;
+  }
+  else if(coeffs_type_str=="MultiCoeffs_LinearBasisSet") {
+    coeffs_type_ = MultiCoeffs_LinearBasisSet;
+  }
+  else {
+    plumed_merror("unknown coeffs type "+coeffs_type_str);
+  }
+}
+
+
 void CoeffsBase::linkVesBias(VesBias* vesbias_pntr_in) {
   vesbias_pntr_ = vesbias_pntr_in;
   action_pntr_ = static_cast<Action*>(vesbias_pntr_in);
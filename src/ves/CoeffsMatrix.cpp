@@ -30,6 +30,7 @@
 #include "tools/Exception.h"
 #include "tools/Random.h"
 #include "tools/Communicator.h"
+#include "blas/blas.h"
 
 #include <vector>
 #include <cmath>
@@ -281,16 +282,67 @@ CoeffsVector operator*(const CoeffsMatrix& coeffs_matrix, const CoeffsVector& co
     }
   }
   else {
+    // symmetric matrix-vector product in packed storage, done row by row
+    // of the upper triangle in the same way as dspmv in BLAS
+    std::vector<double> x = coeffs_vector.getDataAsVector();
+    std::vector<double> y(numcoeffs,0.0);
+    int one=1;
     for(size_t i=0; i<numcoeffs; i++) {
-      for(size_t j=0; j<numcoeffs; j++) {
-        new_coeffs_vector(i) += coeffs_matrix(i,j)*coeffs_vector(j);
+      int len=numcoeffs-i;
+      double* row = const_cast<double*>(&coeffs_matrix.data[coeffs_matrix.getMatrixIndex(i,i)]);
+      y[i] += plumed_blas_ddot(&len,row,&one,&x[i],&one);
+      if(len>1) {
+        len--;
+        plumed_blas_daxpy(&len,&x[i],row+1,&one,&y[i+1],&one);
       }
     }
+    new_coeffs_vector.setValues(y);
   }
   return new_coeffs_vector;
 }
 
 
+void CoeffsMatrix::symmetricRankUpdate(const std::vector<double>& samples, const size_t nsamples, const size_t ld, const double alpha, const double beta) {
+  symmetricRankUpdate(data,samples,nsamples,ld,alpha,beta);
+}
+
+
+void CoeffsMatrix::symmetricRankUpdate(std::vector<double>& packed_data, const std::vector<double>& samples, const size_t nsamples, const size_t ld, const double alpha, const double beta, const size_t rank, const size_t stride) const {
+  plumed_massert(packed_data.size()==size_,"the data is not of the same size as the CoeffsMatrix");
+  plumed_massert(nsamples<=ld && samples.size()>=(nrows_-1)*ld+nsamples,"there are not enough values for the number of samples given");
+  int ns=nsamples;
+  int lda=ld;
+  int one=1;
+  double a=alpha;
+  double b=beta;
+  if(diagonal_) {
+    for(size_t i=rank; i<nrows_; i+=stride) {
+      double sum=0.0;
+      if(nsamples>0) {
+        double* x = const_cast<double*>(&samples[i*ld]);
+        sum = plumed_blas_ddot(&ns,x,&one,x,&one);
+      }
+      packed_data[i] = beta*packed_data[i] + alpha*sum;
+    }
+    return;
+  }
+  // the upper triangle stored row by row is the same as the lower triangle
+  // stored column by column (UPLO='L' in BLAS), the update of each row is a
+  // matrix-vector product with the nsamples x nrows_ matrix of the samples
+  for(size_t i=rank; i<nrows_; i+=stride) {
+    int len=nrows_-i;
+    double* x = const_cast<double*>(&samples[i*ld]);
+    double* row = &packed_data[getMatrixIndex(i,i)];
+    if(nsamples>0) {
+      plumed_blas_dgemv("T",&ns,&len,&a,x,&lda,x,&one,&b,row,&one);
+    }
+    else if(beta!=1.0) {
+      plumed_blas_dscal(&len,&b,row,&one);
+    }
+  }
+}
+
+
 void CoeffsMatrix::addToValue(const size_t index1, const size_t index2, const double value) {
   data[getMatrixIndex(index1,index2)]+=value;
 }
@@ -133,6 +133,12 @@ public:
   const double& operator()(const std::vector<unsigned int>&, const std::vector<unsigned int>&) const;
   //
   friend CoeffsVector operator*(const CoeffsMatrix&, const CoeffsVector&);
+  // symmetric rank-K update, values = beta*values + alpha*sum_k x_k x_k^T, where
+  // the k-th sample of the i-th coefficient is stored at [i*ld+k]
+  void symmetricRankUpdate(const std::vector<double>&, const size_t, const size_t, const double alpha=1.0, const double beta=1.0);
+  // the same for data stored in the same way as the values of this matrix,
+  // only the rows rank, rank+stride, ... of the upper triangle are updated
+  void symmetricRankUpdate(std::vector<double>&, const std::vector<double>&, const size_t, const size_t, const double alpha=1.0, const double beta=1.0, const size_t rank=0, const size_t stride=1) const;
   // add to value
   void addToValue(const size_t, const size_t, const double);
   void addToValue(const std::vector<unsigned int>&, const std::vector<unsigned int>&, const double);
@@ -23,6 +23,7 @@
 #include "CoeffsVector.h"
 #include "CoeffsMatrix.h"
 #include "BasisFunctions.h"
+#include "VesTools.h"
 
 #include "tools/Tools.h"
 #include "core/Value.h"
@@ -868,5 +869,80 @@ size_t CoeffsVector::readDataFromFile(IFile& ifile, const bool ignore_missing_co
 }
 
 
+void CoeffsVector::writeToBinaryFile(std::FILE* fp) const {
+  VesTools::writeBinary(fp,getLabel());
+  VesTools::writeBinary(fp,getDataLabel());
+  VesTools::writeBinary(fp,getTypeStr());
+  VesTools::writeBinary(fp,getOutputFmt());
+  VesTools::writeBinary(fp,numberOfDimensions());
+  for(unsigned int k=0; k<numberOfDimensions(); k++) {
+    VesTools::writeBinary(fp,getDimensionLabel(k));
+    VesTools::writeBinary(fp,shapeOfIndices(k));
+  }
+  VesTools::writeBinary(fp,getIterationCounter());
+  VesTools::writeBinary(fp,getTimeValue());
+  VesTools::writeBinary(fp,averaging_counter);
+  VesTools::writeBinary(fp,data);
+}
+
+
+void CoeffsVector::readFromBinaryFile(std::FILE* fp) {
+  std::string label_f, data_label_f, coeffs_type_f, output_fmt_f;
+  std::vector<std::string> dimension_labels_f;
+  std::vector<unsigned int> indices_shape_f;
+  readBinaryInfo(fp,label_f,data_label_f,coeffs_type_f,output_fmt_f,dimension_labels_f,indices_shape_f);
+  std::string msg_header = "Error when reading in coeffs from binary file: ";
+  if(data_label_f != getDataLabel()) {
+    plumed_merror(msg_header + "the coeffs " + data_label_f + " from file do not match the expected coeffs " + getDataLabel());
+  }
+  checkCoeffsInfo(msg_header, coeffs_type_f, indices_shape_f.size(), data.size(), indices_shape_f);
+  readBinaryData(fp);
+}
+
+
+CoeffsVector* CoeffsVector::createFromBinaryFile(std::FILE* fp, Communicator& cc) {
+  std::string label_f, data_label_f, coeffs_type_f, output_fmt_f;
+  std::vector<std::string> dimension_labels_f;
+  std::vector<unsigned int> indices_shape_f;
+  readBinaryInfo(fp,label_f,data_label_f,coeffs_type_f,output_fmt_f,dimension_labels_f,indices_shape_f);
+  CoeffsVector* coeffs_pntr = new CoeffsVector(label_f,dimension_labels_f,indices_shape_f,cc,true);
+  coeffs_pntr->setLabels(label_f,data_label_f);
+  coeffs_pntr->setTypeFromString(coeffs_type_f);
+  coeffs_pntr->setOutputFmt(output_fmt_f);
+  coeffs_pntr->readBinaryData(fp);
+  return coeffs_pntr;
+}
+
+
+void CoeffsVector::readBinaryInfo(std::FILE* fp, std::string& label_f, std::string& data_label_f, std::string& coeffs_type_f, std::string& output_fmt_f, std::vector<std::string>& dimension_labels_f, std::vector<unsigned int>& indices_shape_f) {
+  VesTools::readBinary(fp,label_f);
+  VesTools::readBinary(fp,data_label_f);
+  VesTools::readBinary(fp,coeffs_type_f);
+  VesTools::readBinary(fp,output_fmt_f);
+  unsigned int ndimensions_f = 0;
+  VesTools::readBinary(fp,ndimensions_f);
+  dimension_labels_f.assign(ndimensions_f,"");
+  indices_shape_f.assign(ndimensions_f,0);
+  for(unsigned int k=0; k<ndimensions_f; k++) {
+    VesTools::readBinary(fp,dimension_labels_f[k]);
+    VesTools::readBinary(fp,indices_shape_f[k]);
+  }
+}
+
+
+void CoeffsVector::readBinaryData(std::FILE* fp) {
+  unsigned int iteration_f = 0;
+  double time_f = 0.0;
+  VesTools::readBinary(fp,iteration_f);
+  VesTools::readBinary(fp,time_f);
+  VesTools::readBinary(fp,averaging_counter);
+  std::vector<double> data_f;
+  VesTools::readBinary(fp,data_f);
+  plumed_massert(data_f.size()==data.size(),"Error when reading in coeffs from binary file: wrong number of coeffs");
+  data = data_f;
+  setIterationCounterAndTime(iteration_f,time_f);
+}
+
+
 }
 }
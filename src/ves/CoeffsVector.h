@@ -27,6 +27,7 @@
 #include <vector>
 #include <string>
 #include <cmath>
+#include <cstdio>
 
 
 namespace PLMD {
@@ -210,6 +211,14 @@ public:
 private:
   void readHeaderFromFile(IFile&, const bool ignore_coeffs_info=false);
   size_t readDataFromFile(IFile&, const bool ignore_missing_coeffs=false);
+public:
+  // unformatted input/output used for the binary checkpoint files
+  void writeToBinaryFile(std::FILE*) const;
+  void readFromBinaryFile(std::FILE*);
+  static CoeffsVector* createFromBinaryFile(std::FILE*, Communicator&);
+private:
+  static void readBinaryInfo(std::FILE*, std::string&, std::string&, std::string&, std::string&, std::vector<std::string>&, std::vector<unsigned int>&);
+  void readBinaryData(std::FILE*);
 public:
   Communicator& getCommunicator() const {return mycomm;}
 };
@@ -32,9 +32,12 @@
 #include "tools/Keywords.h"
 #include "tools/Grid.h"
 #include "tools/Communicator.h"
+#include "tools/OpenMP.h"
 
 #include "GridProjWeights.h"
 
+#include <algorithm>
+
 namespace PLMD {
 namespace ves {
 
@@ -75,7 +78,20 @@ LinearBasisSetExpansion::LinearBasisSetExpansion(
   fes_grid_pntr_(NULL),
   log_targetdist_grid_pntr_(NULL),
   targetdist_grid_pntr_(NULL),
-  targetdist_pntr_(NULL)
+  targetdist_pntr_(NULL),
+  args_values_trsfrm_(nargs_),
+  bf_values_(nargs_),
+  bf_derivs_(nargs_),
+  coeffs_indices_(nargs_),
+  forces_dummy_(nargs_),
+  coeffsderivs_values_dummy_(0),
+  args_values_ws_(nargs_),
+  forces_ws_(nargs_),
+  coeffsderivs_values_ws_(0),
+  separable_evaluation_(false),
+  sep_strides_(0),
+  sep_buffer1_(0),
+  sep_buffer2_(0)
 {
   plumed_massert(args_pntrs_.size()==basisf_pntrs_.size(),"number of arguments and basis functions do not match");
   for(unsigned int k=0; k<nargs_; k++) {nbasisf_[k]=basisf_pntrs_[k]->getNumberOfBasisFunctions();}
@@ -86,6 +102,12 @@ LinearBasisSetExpansion::LinearBasisSetExpansion(
   plumed_massert(bias_coeffs_pntr_->numberOfDimensions()==basisf_pntrs_.size(),"dimension of coeffs does not match with number of basis functions ");
   //
   ncoeffs_ = bias_coeffs_pntr_->numberOfCoeffs();
+  coeffsderivs_values_dummy_.assign(ncoeffs_,0.0);
+  coeffsderivs_values_ws_.assign(ncoeffs_,0.0);
+  for(unsigned int k=0; k<nargs_; k++) {
+    bf_values_[k].assign(nbasisf_[k],0.0);
+    bf_derivs_[k].assign(nbasisf_[k],0.0);
+  }
   targetdist_averages_pntr_ = new CoeffsVector(*bias_coeffs_pntr_);
 
   std::string targetdist_averages_label = bias_coeffs_pntr_->getLabel();
@@ -191,24 +213,7 @@ void LinearBasisSetExpansion::updateBiasGrid() {
   if(action_pntr_!=NULL &&  getStepOfLastBiasGridUpdate()==action_pntr_->getStep()) {
     return;
   }
-  for(Grid::index_t l=0; l<bias_grid_pntr_->getSize(); l++) {
-    std::vector<double> forces(nargs_);
-    std::vector<double> args = bias_grid_pntr_->getPoint(l);
-    bool all_inside=true;
-    double bias=getBiasAndForces(args,all_inside,forces);
-    //
-    if(biasCutoffActive()) {
-      vesbias_pntr_->applyBiasCutoff(bias,forces);
-    }
-    //
-    if(bias_grid_pntr_->hasDerivatives()) {
-      bias_grid_pntr_->setValueAndDerivatives(l,bias,forces);
-    }
-    else {
-      bias_grid_pntr_->setValue(l,bias);
-    }
-    //
-  }
+  calculateBiasOnGrid(bias_grid_pntr_,biasCutoffActive());
   if(vesbias_pntr_!=NULL) {
     vesbias_pntr_->setCurrentBiasMaxValue(bias_grid_pntr_->getMaxValue());
   }
@@ -226,18 +231,7 @@ void LinearBasisSetExpansion::updateBiasWithoutCutoffGrid() {
     return;
   }
   //
-  for(Grid::index_t l=0; l<bias_withoutcutoff_grid_pntr_->getSize(); l++) {
-    std::vector<double> forces(nargs_);
-    std::vector<double> args = bias_withoutcutoff_grid_pntr_->getPoint(l);
-    bool all_inside=true;
-    double bias=getBiasAndForces(args,all_inside,forces);
-    if(bias_withoutcutoff_grid_pntr_->hasDerivatives()) {
-      bias_withoutcutoff_grid_pntr_->setValueAndDerivatives(l,bias,forces);
-    }
-    else {
-      bias_withoutcutoff_grid_pntr_->setValue(l,bias);
-    }
-  }
+  calculateBiasOnGrid(bias_withoutcutoff_grid_pntr_,false);
   //
   double bias_max = bias_withoutcutoff_grid_pntr_->getMaxValue();
   double bias_min = bias_withoutcutoff_grid_pntr_->getMinValue();
@@ -258,13 +252,21 @@ void LinearBasisSetExpansion::updateBiasWithoutCutoffGrid() {
   if(bias_shifted) {
     // this should be done inside a grid function really,
     // need to define my grid class for that
-    for(Grid::index_t l=0; l<bias_withoutcutoff_grid_pntr_->getSize(); l++) {
-      if(bias_withoutcutoff_grid_pntr_->hasDerivatives()) {
-        std::vector<double> zeros(nargs_,0.0);
-        bias_withoutcutoff_grid_pntr_->addValueAndDerivatives(l,shift,zeros);
-      }
-      else {
-        bias_withoutcutoff_grid_pntr_->addValue(l,shift);
+    const Grid::index_t ngrid = bias_withoutcutoff_grid_pntr_->getSize();
+    unsigned nt=OpenMP::getNumThreads();
+    if(nt*100>ngrid) {nt=ngrid/100;}
+    if(nt==0) {nt=1;}
+    #pragma omp parallel num_threads(nt)
+    {
+      std::vector<double> zeros(nargs_,0.0);
+      #pragma omp for
+      for(Grid::index_t l=0; l<ngrid; l++) {
+        if(bias_withoutcutoff_grid_pntr_->hasDerivatives()) {
+          bias_withoutcutoff_grid_pntr_->addValueAndDerivatives(l,shift,zeros);
+        }
+        else {
+          bias_withoutcutoff_grid_pntr_->addValue(l,shift);
+        }
       }
     }
   }
@@ -285,7 +287,12 @@ void LinearBasisSetExpansion::updateFesGrid() {
   }
   //
   double bias2fes_scalingf = -1.0;
-  for(Grid::index_t l=0; l<fes_grid_pntr_->getSize(); l++) {
+  const Grid::index_t ngrid = fes_grid_pntr_->getSize();
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*100>ngrid) {nt=ngrid/100;}
+  if(nt==0) {nt=1;}
+  #pragma omp parallel for num_threads(nt)
+  for(Grid::index_t l=0; l<ngrid; l++) {
     double fes_value = bias2fes_scalingf*bias_grid_pntr_->getValue(l);
     if(log_targetdist_grid_pntr_!=NULL) {
       fes_value += kBT()*log_targetdist_grid_pntr_->getValue(l);
@@ -299,6 +306,103 @@ void LinearBasisSetExpansion::updateFesGrid() {
 }
 
 
+void LinearBasisSetExpansion::calculateBiasOnGrid(Grid* grid_pntr, const bool apply_bias_cutoff) {
+  const Grid::index_t ngrid = grid_pntr->getSize();
+  const bool usederiv = grid_pntr->hasDerivatives();
+  plumed_assert(grid_pntr->getDimension()==nargs_);
+  // the grid is a tensor product so the basis functions only need to be
+  // calculated once for each bin along each axis, these tables are cached
+  // by the basis functions
+  std::vector<const std::vector<double>*> bf_values_table(nargs_);
+  std::vector<const std::vector<double>*> bf_derivs_table(nargs_);
+  for(unsigned int k=0; k<nargs_; k++) {
+    bf_values_table[k] = &basisf_pntrs_[k]->getAllValuesOnGridAxis(grid_pntr,k);
+    bf_derivs_table[k] = &basisf_pntrs_[k]->getAllDerivsOnGridAxis(grid_pntr,k);
+  }
+  // the grid points are distributed over the MPI ranks in contiguous blocks
+  // and the values are summed once at the end
+  Grid::index_t block_begin=0;
+  Grid::index_t block_end=ngrid;
+  // all the ranks should agree on this, as it decides whether the collective sum below is done
+  const bool split_over_ranks = !serial_ && mycomm_.Get_size()>1;
+  if(split_over_ranks) {
+    size_t begin, end;
+    VesTools::getBlockOfIndices(ngrid,mycomm_.Get_rank(),mycomm_.Get_size(),begin,end);
+    block_begin=begin;
+    block_end=end;
+  }
+  std::vector<double> grid_values(ngrid,0.0);
+  std::vector<double> grid_derivs(usederiv?ngrid*nargs_:0,0.0);
+  //
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*10>block_end-block_begin) {nt=(block_end-block_begin)/10;}
+  if(nt==0) {nt=1;}
+  #pragma omp parallel num_threads(nt)
+  {
+    // workspace of each thread
+    std::vector<std::vector<double> > bf_values(nargs_);
+    std::vector<std::vector<double> > bf_derivs(nargs_);
+    for(unsigned int k=0; k<nargs_; k++) {
+      bf_values[k].assign(nbasisf_[k],0.0);
+      bf_derivs[k].assign(nbasisf_[k],0.0);
+    }
+    std::vector<unsigned> grid_indices(nargs_);
+    std::vector<unsigned int> coeffs_indices(nargs_);
+    std::vector<double> forces(nargs_);
+    std::vector<double> buffer1(sep_buffer1_.size());
+    std::vector<double> buffer2(sep_buffer2_.size());
+    //
+    #pragma omp for
+    for(Grid::index_t l=block_begin; l<block_end; l++) {
+      grid_pntr->getIndices(l,grid_indices);
+      for(unsigned int k=0; k<nargs_; k++) {
+        const size_t offset = grid_indices[k]*nbasisf_[k];
+        for(unsigned int m=0; m<nbasisf_[k]; m++) {
+          bf_values[k][m]=(*bf_values_table[k])[offset+m];
+          bf_derivs[k][m]=(*bf_derivs_table[k])[offset+m];
+        }
+      }
+      double bias;
+      if(separable_evaluation_) {
+        bias=getBiasAndForcesFromBasisValuesSeparable(bf_values,bf_derivs,forces,NULL,buffer1,buffer2);
+      }
+      else {
+        bias=getBiasAndForcesFromBasisValues(bf_values,bf_derivs,forces,NULL,bias_coeffs_pntr_,0,ncoeffs_,coeffs_indices);
+      }
+      if(apply_bias_cutoff) {
+        vesbias_pntr_->applyBiasCutoff(bias,forces);
+      }
+      grid_values[l]=bias;
+      if(usederiv) {
+        for(unsigned int k=0; k<nargs_; k++) {grid_derivs[l*nargs_+k]=forces[k];}
+      }
+    }
+  }
+  if(split_over_ranks) {
+    mycomm_.Sum(grid_values);
+    if(usederiv) {mycomm_.Sum(grid_derivs);}
+  }
+  //
+  nt=OpenMP::getNumThreads();
+  if(nt*100>ngrid) {nt=ngrid/100;}
+  if(nt==0) {nt=1;}
+  #pragma omp parallel num_threads(nt)
+  {
+    std::vector<double> forces(nargs_);
+    #pragma omp for
+    for(Grid::index_t l=0; l<ngrid; l++) {
+      if(usederiv) {
+        for(unsigned int k=0; k<nargs_; k++) {forces[k]=grid_derivs[l*nargs_+k];}
+        grid_pntr->setValueAndDerivatives(l,grid_values[l],forces);
+      }
+      else {
+        grid_pntr->setValue(l,grid_values[l]);
+      }
+    }
+  }
+}
+
+
 void LinearBasisSetExpansion::writeBiasGridToFile(OFile& ofile, const bool append_file) const {
   plumed_massert(bias_grid_pntr_!=NULL,"the bias grid is not defined");
   if(append_file) {ofile.enforceRestart();}
@@ -320,14 +424,20 @@ void LinearBasisSetExpansion::writeFesGridToFile(OFile& ofile, const bool append
 }
 
 
-void LinearBasisSetExpansion::writeFesProjGridToFile(const std::vector<std::string>& proj_arg, OFile& ofile, const bool append_file) const {
+Grid LinearBasisSetExpansion::getFesProjGrid(const std::vector<std::string>& proj_arg) const {
   plumed_massert(fes_grid_pntr_!=NULL,"the FES grid is not defined");
   FesWeight* Fw = new FesWeight(beta_);
   Grid proj_grid = fes_grid_pntr_->project(proj_arg,Fw);
   proj_grid.setMinToZero();
+  delete Fw;
+  return proj_grid;
+}
+
+
+void LinearBasisSetExpansion::writeFesProjGridToFile(const std::vector<std::string>& proj_arg, OFile& ofile, const bool append_file) const {
+  Grid proj_grid = getFesProjGrid(proj_arg);
   if(append_file) {ofile.enforceRestart();}
   proj_grid.writeToFile(ofile);
-  delete Fw;
 }
 
 
@@ -345,10 +455,16 @@ void LinearBasisSetExpansion::writeLogTargetDistGridToFile(OFile& ofile, const b
 }
 
 
+Grid LinearBasisSetExpansion::getTargetDistProjGrid(const std::vector<std::string>& proj_arg) const {
+  plumed_massert(targetdist_grid_pntr_!=NULL,"the target distribution grid is not defined");
+  return TargetDistribution::getMarginalDistributionGrid(targetdist_grid_pntr_,proj_arg);
+}
+
+
 void LinearBasisSetExpansion::writeTargetDistProjGridToFile(const std::vector<std::string>& proj_arg, OFile& ofile, const bool append_file) const {
   if(targetdist_grid_pntr_==NULL) {return;}
   if(append_file) {ofile.enforceRestart();}
-  Grid proj_grid = TargetDistribution::getMarginalDistributionGrid(targetdist_grid_pntr_,proj_arg);
+  Grid proj_grid = getTargetDistProjGrid(proj_arg);
   proj_grid.writeToFile(ofile);
 }
 
@@ -368,47 +484,104 @@ void LinearBasisSetExpansion::writeTargetDistributionToFile(const std::string& f
 
 
 double LinearBasisSetExpansion::getBiasAndForces(const std::vector<double>& args_values, bool& all_inside, std::vector<double>& forces, std::vector<double>& coeffsderivs_values, std::vector<BasisFunctions*>& basisf_pntrs_in, CoeffsVector* coeffs_pntr_in, Communicator* comm_in) {
+  unsigned int nargs = args_values.size();
+  std::vector<double> args_values_trsfrm(nargs);
+  std::vector< std::vector <double> > bf_values(nargs);
+  std::vector< std::vector <double> > bf_derivs(nargs);
+  for(unsigned int k=0; k<nargs; k++) {
+    bf_values[k].assign(basisf_pntrs_in[k]->getNumberOfBasisFunctions(),0.0);
+    bf_derivs[k].assign(basisf_pntrs_in[k]->getNumberOfBasisFunctions(),0.0);
+  }
+  std::vector<unsigned int> indices(nargs);
+  std::vector<double> omp_bias;
+  std::vector<std::vector<double> > omp_forces;
+  std::vector<std::vector<unsigned int> > omp_indices;
+  return getBiasAndForces(args_values,all_inside,forces,coeffsderivs_values,basisf_pntrs_in,coeffs_pntr_in,comm_in,args_values_trsfrm,bf_values,bf_derivs,indices,omp_bias,omp_forces,omp_indices);
+}
+
+
+double LinearBasisSetExpansion::getBiasAndForces(const std::vector<double>& args_values, bool& all_inside, std::vector<double>& forces, std::vector<double>& coeffsderivs_values, std::vector<BasisFunctions*>& basisf_pntrs_in, CoeffsVector* coeffs_pntr_in, Communicator* comm_in, std::vector<double>& args_values_trsfrm, std::vector<std::vector<double> >& bf_values, std::vector<std::vector<double> >& bf_derivs, std::vector<unsigned int>& indices, std::vector<double>& omp_bias, std::vector<std::vector<double> >& omp_forces, std::vector<std::vector<unsigned int> >& omp_indices) {
+  // the workspace vectors args_values_trsfrm, bf_values, bf_derivs, and indices
+  // need to be of the correct size, they are not resized here.
+  // the per-thread buffers omp_bias, omp_forces, and omp_indices are resized
+  // when needed, which only allocates memory if the number of threads changes
   unsigned int nargs = args_values.size();
   plumed_assert(coeffs_pntr_in->numberOfDimensions()==nargs);
   plumed_assert(basisf_pntrs_in.size()==nargs);
   plumed_assert(forces.size()==nargs);
   plumed_assert(coeffsderivs_values.size()==coeffs_pntr_in->numberOfCoeffs());
+  plumed_dbg_assert(args_values_trsfrm.size()==nargs && bf_values.size()==nargs && bf_derivs.size()==nargs && indices.size()==nargs);
 
-  std::vector<double> args_values_trsfrm(nargs);
-  // std::vector<bool>   inside_interval(nargs,true);
   all_inside = true;
   //
-  std::vector< std::vector <double> > bf_values(nargs);
-  std::vector< std::vector <double> > bf_derivs(nargs);
-  //
   for(unsigned int k=0; k<nargs; k++) {
-    bf_values[k].assign(basisf_pntrs_in[k]->getNumberOfBasisFunctions(),0.0);
-    bf_derivs[k].assign(basisf_pntrs_in[k]->getNumberOfBasisFunctions(),0.0);
     bool curr_inside=true;
     basisf_pntrs_in[k]->getAllValues(args_values[k],args_values_trsfrm[k],curr_inside,bf_values[k],bf_derivs[k]);
-    // inside_interval[k]=curr_inside;
     if(!curr_inside) {all_inside=false;}
-    forces[k]=0.0;
   }
   //
-  size_t stride=1;
-  size_t rank=0;
-  if(comm_in!=NULL)
-  {
-    stride=comm_in->Get_size();
-    rank=comm_in->Get_rank();
+  // each rank takes a contiguous block of the coeffs
+  const size_t ncoeffs = coeffs_pntr_in->numberOfCoeffs();
+  size_t begin=0;
+  size_t end=ncoeffs;
+  if(comm_in!=NULL) {
+    VesTools::getBlockOfIndices(ncoeffs,comm_in->Get_rank(),comm_in->Get_size(),begin,end);
+  }
+  // the block is further split into contiguous chunks over the threads,
+  // small basis sets are done serially
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*1000>end-begin) {nt=(end-begin)/1000;}
+  if(nt==0) {nt=1;}
+  double bias=0.0;
+  if(nt==1) {
+    bias = getBiasAndForcesFromBasisValues(bf_values,bf_derivs,forces,&coeffsderivs_values,coeffs_pntr_in,begin,end,indices);
+  }
+  else {
+    // the results of the chunks are summed in a fixed order afterwards
+    // such that the result does not depend on the scheduling of the threads
+    omp_bias.resize(nt);
+    omp_forces.resize(nt);
+    omp_indices.resize(nt);
+    for(unsigned int c=0; c<nt; c++) {
+      omp_forces[c].resize(nargs);
+      omp_indices[c].resize(nargs);
+    }
+    #pragma omp parallel for num_threads(nt)
+    for(unsigned int c=0; c<nt; c++) {
+      size_t chunk_begin, chunk_end;
+      VesTools::getBlockOfIndices(end-begin,c,nt,chunk_begin,chunk_end);
+      omp_bias[c] = getBiasAndForcesFromBasisValues(bf_values,bf_derivs,omp_forces[c],&coeffsderivs_values,coeffs_pntr_in,begin+chunk_begin,begin+chunk_end,omp_indices[c]);
+    }
+    for(unsigned int k=0; k<nargs; k++) {forces[k]=0.0;}
+    for(unsigned int c=0; c<nt; c++) {
+      bias += omp_bias[c];
+      for(unsigned int k=0; k<nargs; k++) {forces[k]+=omp_forces[c][k];}
+    }
   }
+  //
+  if(comm_in!=NULL) {
+    // coeffsderivs_values is not summed as the mpi Sum is done later on for the averages
+    comm_in->Sum(bias);
+    comm_in->Sum(forces);
+  }
+  return bias;
+}
+
+
+double LinearBasisSetExpansion::getBiasAndForcesFromBasisValues(const std::vector<std::vector<double> >& bf_values, const std::vector<std::vector<double> >& bf_derivs, std::vector<double>& forces, std::vector<double>* coeffsderivs_values, CoeffsVector* coeffs_pntr_in, const size_t begin, const size_t end, std::vector<unsigned int>& indices) {
+  unsigned int nargs = bf_values.size();
+  for(unsigned int k=0; k<nargs; k++) {forces[k]=0.0;}
   // loop over coeffs
   double bias=0.0;
-  for(size_t i=rank; i<coeffs_pntr_in->numberOfCoeffs(); i+=stride) {
-    std::vector<unsigned int> indices=coeffs_pntr_in->getIndices(i);
+  for(size_t i=begin; i<end; i++) {
+    coeffs_pntr_in->getIndices(i,indices);
     double coeff = coeffs_pntr_in->getValue(i);
     double bf_curr=1.0;
     for(unsigned int k=0; k<nargs; k++) {
       bf_curr*=bf_values[k][indices[k]];
     }
     bias+=coeff*bf_curr;
-    coeffsderivs_values[i] = bf_curr;
+    if(coeffsderivs_values!=NULL) {(*coeffsderivs_values)[i] = bf_curr;}
     for(unsigned int k=0; k<nargs; k++) {
       double der = 1.0;
       for(unsigned int l=0; l<nargs; l++) {
@@ -420,52 +593,188 @@ double LinearBasisSetExpansion::getBiasAndForces(const std::vector<double>& args
       // forces[k]-=coeff*bf_curr*(bf_derivs[k][indices[k]]/bf_values[k][indices[k]]);
     }
   }
+  return bias;
+}
+
+
+void LinearBasisSetExpansion::enableSeparableEvaluation() {
+  plumed_massert(bias_coeffs_pntr_->isLinearBasisSetCoeffs(),"separable evaluation can only be used for coefficients of a linear basis set");
+  separable_evaluation_=true;
+  // workspace is allocated once here such that the evaluation does not allocate any memory
+  sep_strides_.resize(nargs_+1);
+  sep_strides_[0]=1;
+  for(unsigned int k=0; k<nargs_; k++) {
+    sep_strides_[k+1]=sep_strides_[k]*nbasisf_[k];
+  }
+  plumed_massert(sep_strides_[nargs_]==ncoeffs_,"the shape of the coeffs does not match the basis functions");
+  // at most nargs_+1 tensors of size ncoeffs_/nbasisf_[nargs_-1] are needed in the contraction
+  sep_buffer1_.assign((nargs_+1)*sep_strides_[nargs_-1],0.0);
+  sep_buffer2_.assign((nargs_+1)*sep_strides_[nargs_-1],0.0);
+}
+
+
+double LinearBasisSetExpansion::getBiasAndForcesSeparable(const std::vector<double>& args_values, bool& all_inside, std::vector<double>& forces, std::vector<double>* coeffsderivs_values) {
+  /*
+  The bias is a tensor product of one-dimensional basis functions,
+      V(s) = sum_{i_0,...,i_{n-1}} c_{i_0,...,i_{n-1}} f_{i_0}(s_0) ... f_{i_{n-1}}(s_{n-1}),
+  so instead of looping over all coeffs and decoding their indices the coeffs
+  tensor is contracted one dimension at a time, starting from the slowest
+  running (last) index. At each stage the value tensor is contracted with the
+  basis function values and derivatives of the current dimension, while the
+  derivative tensors of the previous dimensions are contracted with the values.
+  */
+  plumed_dbg_assert(separable_evaluation_);
+  plumed_dbg_assert(args_values.size()==nargs_);
+  all_inside = true;
+  for(unsigned int k=0; k<nargs_; k++) {
+    bool curr_inside=true;
+    basisf_pntrs_[k]->getAllValues(args_values[k],args_values_trsfrm_[k],curr_inside,bf_values_[k],bf_derivs_[k]);
+    if(!curr_inside) {all_inside=false;}
+  }
+  return getBiasAndForcesFromBasisValuesSeparable(bf_values_,bf_derivs_,forces,coeffsderivs_values,sep_buffer1_,sep_buffer2_);
+}
+
+
+double LinearBasisSetExpansion::getBiasAndForcesFromBasisValuesSeparable(const std::vector<std::vector<double> >& bf_values_in, const std::vector<std::vector<double> >& bf_derivs_in, std::vector<double>& forces, std::vector<double>* coeffsderivs_values, std::vector<double>& buffer1, std::vector<double>& buffer2) const {
+  plumed_dbg_assert(forces.size()==nargs_);
+  plumed_dbg_assert(buffer1.size()==sep_buffer1_.size() && buffer2.size()==sep_buffer2_.size());
+  //
+  const double* in = &BiasCoeffs()[0];
+  double* in_buffer = &buffer1[0];
+  double* out_buffer = &buffer2[0];
+  for(unsigned int k=nargs_; k-->0;) {
+    const size_t size_out = sep_strides_[k];
+    const size_t size_in = sep_strides_[k+1];
+    const unsigned int nbf = nbasisf_[k];
+    const double* bf_values = &bf_values_in[k][0];
+    const double* bf_derivs = &bf_derivs_in[k][0];
+    // tensor 0 is the value, tensor j+1 the derivative with respect to argument j
+    double* out_value = out_buffer;
+    double* out_deriv = out_buffer+(k+1)*size_out;
+    for(size_t a=0; a<size_out; a++) {
+      out_value[a]=0.0;
+      out_deriv[a]=0.0;
+    }
+    for(unsigned int m=0; m<nbf; m++) {
+      const double* in_m = in+m*size_out;
+      const double fv = bf_values[m];
+      const double fd = bf_derivs[m];
+      for(size_t a=0; a<size_out; a++) {
+        out_value[a] += fv*in_m[a];
+        out_deriv[a] += fd*in_m[a];
+      }
+    }
+    for(unsigned int j=k+1; j<nargs_; j++) {
+      const double* in_deriv = in_buffer+(j+1)*size_in;
+      double* out_deriv_j = out_buffer+(j+1)*size_out;
+      for(size_t a=0; a<size_out; a++) {out_deriv_j[a]=0.0;}
+      for(unsigned int m=0; m<nbf; m++) {
+        const double* in_m = in_deriv+m*size_out;
+        const double fv = bf_values[m];
+        for(size_t a=0; a<size_out; a++) {
+          out_deriv_j[a] += fv*in_m[a];
+        }
+      }
+    }
+    std::swap(in_buffer,out_buffer);
+    in = in_buffer;
+  }
+  // after the last contraction all tensors are scalars
+  double bias = in_buffer[0];
+  for(unsigned int k=0; k<nargs_; k++) {
+    forces[k] = -in_buffer[k+1];
+  }
   //
-  if(comm_in!=NULL) {
-    // coeffsderivs_values is not summed as the mpi Sum is done later on for the averages
-    comm_in->Sum(bias);
-    comm_in->Sum(forces);
+  if(coeffsderivs_values!=NULL) {
+    // outer product of the basis function values, built in place
+    plumed_dbg_assert(coeffsderivs_values->size()==ncoeffs_);
+    double* cd = &(*coeffsderivs_values)[0];
+    for(unsigned int m=0; m<nbasisf_[0]; m++) {cd[m]=bf_values_in[0][m];}
+    for(unsigned int k=1; k<nargs_; k++) {
+      const size_t size_prev = sep_strides_[k];
+      for(unsigned int m=nbasisf_[k]; m-->0;) {
+        const double fv = bf_values_in[k][m];
+        double* cd_m = cd+m*size_prev;
+        for(size_t a=0; a<size_prev; a++) {
+          cd_m[a] = cd[a]*fv;
+        }
+      }
+    }
   }
   return bias;
 }
 
 
 void LinearBasisSetExpansion::getBasisSetValues(const std::vector<double>& args_values, std::vector<double>& basisset_values, std::vector<BasisFunctions*>& basisf_pntrs_in, CoeffsVector* coeffs_pntr_in, Communicator* comm_in) {
+  unsigned int nargs = args_values.size();
+  std::vector<double> args_values_trsfrm(nargs);
+  std::vector< std::vector <double> > bf_values(nargs);
+  std::vector< std::vector <double> > bf_derivs(nargs);
+  for(unsigned int k=0; k<nargs; k++) {
+    bf_values[k].assign(basisf_pntrs_in[k]->getNumberOfBasisFunctions(),0.0);
+    bf_derivs[k].assign(basisf_pntrs_in[k]->getNumberOfBasisFunctions(),0.0);
+  }
+  std::vector<unsigned int> indices(nargs);
+  std::vector<std::vector<unsigned int> > omp_indices;
+  getBasisSetValues(args_values,basisset_values,basisf_pntrs_in,coeffs_pntr_in,comm_in,args_values_trsfrm,bf_values,bf_derivs,indices,omp_indices);
+}
+
+
+void LinearBasisSetExpansion::getBasisSetValues(const std::vector<double>& args_values, std::vector<double>& basisset_values, std::vector<BasisFunctions*>& basisf_pntrs_in, CoeffsVector* coeffs_pntr_in, Communicator* comm_in, std::vector<double>& args_values_trsfrm, std::vector<std::vector<double> >& bf_values, std::vector<std::vector<double> >& bf_derivs, std::vector<unsigned int>& indices, std::vector<std::vector<unsigned int> >& omp_indices) {
   unsigned int nargs = args_values.size();
   plumed_assert(coeffs_pntr_in->numberOfDimensions()==nargs);
   plumed_assert(basisf_pntrs_in.size()==nargs);
-
-  std::vector<double> args_values_trsfrm(nargs);
-  std::vector< std::vector <double> > bf_values;
+  plumed_dbg_assert(args_values_trsfrm.size()==nargs && bf_values.size()==nargs && bf_derivs.size()==nargs && indices.size()==nargs);
   //
   for(unsigned int k=0; k<nargs; k++) {
-    std::vector<double> tmp_val(basisf_pntrs_in[k]->getNumberOfBasisFunctions());
-    std::vector<double> tmp_der(tmp_val.size());
     bool inside=true;
-    basisf_pntrs_in[k]->getAllValues(args_values[k],args_values_trsfrm[k],inside,tmp_val,tmp_der);
-    bf_values.push_back(tmp_val);
+    basisf_pntrs_in[k]->getAllValues(args_values[k],args_values_trsfrm[k],inside,bf_values[k],bf_derivs[k]);
   }
   //
-  size_t stride=1;
-  size_t rank=0;
-  if(comm_in!=NULL)
-  {
-    stride=comm_in->Get_size();
-    rank=comm_in->Get_rank();
+  // each rank takes a contiguous block of the basis set
+  const size_t ncoeffs = coeffs_pntr_in->numberOfCoeffs();
+  size_t begin=0;
+  size_t end=ncoeffs;
+  if(comm_in!=NULL) {
+    VesTools::getBlockOfIndices(ncoeffs,comm_in->Get_rank(),comm_in->Get_size(),begin,end);
+  }
+  // the block is further split over the threads, small basis sets are done serially
+  unsigned nt=OpenMP::getNumThreads();
+  if(nt*1000>end-begin) {nt=(end-begin)/1000;}
+  if(nt==0) {nt=1;}
+  if(nt==1) {
+    getBasisSetValuesFromBasisValues(bf_values,basisset_values,coeffs_pntr_in,begin,end,indices);
+  }
+  else {
+    // the per-thread indices are only resized when the number of threads changes
+    omp_indices.resize(nt);
+    for(unsigned int c=0; c<nt; c++) {omp_indices[c].resize(nargs);}
+    #pragma omp parallel for num_threads(nt)
+    for(unsigned int c=0; c<nt; c++) {
+      size_t chunk_begin, chunk_end;
+      VesTools::getBlockOfIndices(end-begin,c,nt,chunk_begin,chunk_end);
+      getBasisSetValuesFromBasisValues(bf_values,basisset_values,coeffs_pntr_in,begin+chunk_begin,begin+chunk_end,omp_indices[c]);
+    }
+  }
+  //
+  if(comm_in!=NULL && comm_in->Get_size()>1) {
+    for(size_t i=0; i<begin; i++) {basisset_values[i]=0.0;}
+    for(size_t i=end; i<ncoeffs; i++) {basisset_values[i]=0.0;}
+    comm_in->Sum(basisset_values);
   }
-  // loop over basis set
-  for(size_t i=rank; i<coeffs_pntr_in->numberOfCoeffs(); i+=stride) {
-    std::vector<unsigned int> indices=coeffs_pntr_in->getIndices(i);
+}
+
+
+void LinearBasisSetExpansion::getBasisSetValuesFromBasisValues(const std::vector<std::vector<double> >& bf_values, std::vector<double>& basisset_values, CoeffsVector* coeffs_pntr_in, const size_t begin, const size_t end, std::vector<unsigned int>& indices) {
+  unsigned int nargs = bf_values.size();
+  for(size_t i=begin; i<end; i++) {
+    coeffs_pntr_in->getIndices(i,indices);
     double bf_curr=1.0;
     for(unsigned int k=0; k<nargs; k++) {
       bf_curr*=bf_values[k][indices[k]];
     }
     basisset_values[i] = bf_curr;
   }
-  //
-  if(comm_in!=NULL) {
-    comm_in->Sum(basisset_values);
-  }
 }
 
 
@@ -495,21 +804,20 @@ double LinearBasisSetExpansion::getBasisSetValue(const std::vector<double>& args
 
 
 void LinearBasisSetExpansion::setupUniformTargetDistribution() {
-  std::vector< std::vector <double> > bf_integrals(0);
-  std::vector<double> targetdist_averages(ncoeffs_,0.0);
-  //
+  // the averages are the outer product of the integrals of each basis set
+  std::vector<double> targetdist_averages(1,1.0);
   for(unsigned int k=0; k<nargs_; k++) {
-    bf_integrals.push_back(basisf_pntrs_[k]->getUniformIntegrals());
-  }
-  //
-  for(size_t i=0; i<ncoeffs_; i++) {
-    std::vector<unsigned int> indices=bias_coeffs_pntr_->getIndices(i);
-    double value = 1.0;
-    for(unsigned int k=0; k<nargs_; k++) {
-      value*=bf_integrals[k][indices[k]];
+    std::vector<double> bf_integrals = basisf_pntrs_[k]->getUniformIntegrals();
+    const size_t size = targetdist_averages.size();
+    std::vector<double> tmp(size*nbasisf_[k]);
+    for(unsigned int m=0; m<nbasisf_[k]; m++) {
+      for(size_t a=0; a<size; a++) {
+        tmp[a+size*m] = targetdist_averages[a]*bf_integrals[m];
+      }
     }
-    targetdist_averages[i]=value;
+    targetdist_averages.swap(tmp);
   }
+  plumed_assert(targetdist_averages.size()==ncoeffs_);
   TargetDistAverages() = targetdist_averages;
 }
 
@@ -570,24 +878,43 @@ void LinearBasisSetExpansion::restartTargetDistribution() {
 
 void LinearBasisSetExpansion::calculateTargetDistAveragesFromGrid(const Grid* targetdist_grid_pntr) {
   plumed_assert(targetdist_grid_pntr!=NULL);
-  std::vector<double> targetdist_averages(ncoeffs_,0.0);
+  plumed_assert(targetdist_grid_pntr->getDimension()==nargs_);
   std::vector<double> integration_weights = GridIntegrationWeights::getIntegrationWeights(targetdist_grid_pntr);
-  Grid::index_t stride=mycomm_.Get_size();
-  Grid::index_t rank=mycomm_.Get_rank();
-  for(Grid::index_t l=rank; l<targetdist_grid_pntr->getSize(); l+=stride) {
-    std::vector<double> args_values = targetdist_grid_pntr->getPoint(l);
-    std::vector<double> basisset_values(ncoeffs_);
-    // parallelization done over the grid -> should NOT use parallel in getBasisSetValues!!
-    getBasisSetValues(args_values,basisset_values,false);
-    double weight = integration_weights[l]*targetdist_grid_pntr->getValue(l);
-    for(unsigned int i=0; i<ncoeffs_; i++) {
-      targetdist_averages[i] += weight*basisset_values[i];
+  std::vector<double> tensor(targetdist_grid_pntr->getSize());
+  for(Grid::index_t l=0; l<targetdist_grid_pntr->getSize(); l++) {
+    tensor[l] = integration_weights[l]*targetdist_grid_pntr->getValue(l);
+  }
+  // the weighted target distribution is contracted with the table of the
+  // basis functions on each grid axis in turn, after contracting axis k the
+  // tensor has the shape (nbasisf_[0],...,nbasisf_[k],nbin[k+1],...,nbin[nargs_-1])
+  std::vector<unsigned int> shape = targetdist_grid_pntr->getNbin();
+  std::vector<double> contracted;
+  for(unsigned int k=0; k<nargs_; k++) {
+    const std::vector<double>& bf_values = basisf_pntrs_[k]->getAllValuesOnGridAxis(targetdist_grid_pntr,k);
+    size_t inner=1;
+    for(unsigned int j=0; j<k; j++) {inner*=shape[j];}
+    size_t outer=1;
+    for(unsigned int j=k+1; j<nargs_; j++) {outer*=shape[j];}
+    const unsigned int nbin = shape[k];
+    const unsigned int nbf = nbasisf_[k];
+    contracted.assign(inner*nbf*outer,0.0);
+    for(size_t c=0; c<outer; c++) {
+      for(unsigned int b=0; b<nbin; b++) {
+        const double* in = &tensor[inner*(b+nbin*c)];
+        for(unsigned int m=0; m<nbf; m++) {
+          const double value = bf_values[b*nbf+m];
+          double* out = &contracted[inner*(m+nbf*c)];
+          for(size_t a=0; a<inner; a++) {out[a] += value*in[a];}
+        }
+      }
     }
+    tensor.swap(contracted);
+    shape[k] = nbf;
   }
-  mycomm_.Sum(targetdist_averages);
+  plumed_assert(tensor.size()==ncoeffs_);
   // the overall constant;
-  targetdist_averages[0] = getBasisSetConstant();
-  TargetDistAverages() = targetdist_averages;
+  tensor[0] = getBasisSetConstant();
+  TargetDistAverages() = tensor;
 }
 
 
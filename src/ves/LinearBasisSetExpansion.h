@@ -83,6 +83,26 @@ private:
   Grid* targetdist_grid_pntr_;
   //
   TargetDistribution* targetdist_pntr_;
+  //
+  // workspace such that evaluating the bias does not allocate memory
+  std::vector<double> args_values_trsfrm_;
+  std::vector<std::vector<double> > bf_values_;
+  std::vector<std::vector<double> > bf_derivs_;
+  std::vector<unsigned int> coeffs_indices_;
+  std::vector<double> forces_dummy_;
+  std::vector<double> coeffsderivs_values_dummy_;
+  std::vector<double> args_values_ws_;
+  std::vector<double> forces_ws_;
+  std::vector<double> coeffsderivs_values_ws_;
+  // per-thread buffers, only resized when the number of threads changes
+  std::vector<double> omp_bias_;
+  std::vector<std::vector<double> > omp_forces_;
+  std::vector<std::vector<unsigned int> > omp_indices_;
+  //
+  bool separable_evaluation_;
+  std::vector<size_t> sep_strides_;
+  std::vector<double> sep_buffer1_;
+  std::vector<double> sep_buffer2_;
 public:
   static void registerKeywords( Keywords& keys );
   // Constructor
@@ -104,6 +124,10 @@ public:
   std::vector<BasisFunctions*> getPntrsToBasisFunctions() const {return basisf_pntrs_;}
   CoeffsVector* getPntrToBiasCoeffs() const {return bias_coeffs_pntr_;}
   Grid* getPntrToBiasGrid() const {return bias_grid_pntr_;};
+  Grid* getPntrToBiasWithoutCutoffGrid() const {return bias_withoutcutoff_grid_pntr_;};
+  Grid* getPntrToFesGrid() const {return fes_grid_pntr_;};
+  Grid* getPntrToTargetDistGrid() const {return targetdist_grid_pntr_;};
+  Grid* getPntrToLogTargetDistGrid() const {return log_targetdist_grid_pntr_;};
   //
   unsigned int getNumberOfArguments() const {return nargs_;};
   std::vector<unsigned int> getNumberOfBasisFunctions() const {return nbasisf_;};
@@ -115,15 +139,30 @@ public:
   void setSerial() {serial_=true;}
   void setParallel() {serial_=false;}
   //
+  void enableSeparableEvaluation();
+  void disableSeparableEvaluation() {separable_evaluation_=false;}
+  bool separableEvaluationActive() const {return separable_evaluation_;}
+  //
   void linkVesBias(VesBias*);
   void linkAction(Action*);
   // calculate bias and derivatives
   static double getBiasAndForces(const std::vector<double>&, bool&, std::vector<double>&, std::vector<double>&, std::vector<BasisFunctions*>&, CoeffsVector*, Communicator* comm_in=NULL);
+  static double getBiasAndForces(const std::vector<double>&, bool&, std::vector<double>&, std::vector<double>&, std::vector<BasisFunctions*>&, CoeffsVector*, Communicator*, std::vector<double>&, std::vector<std::vector<double> >&, std::vector<std::vector<double> >&, std::vector<unsigned int>&, std::vector<double>&, std::vector<std::vector<double> >&, std::vector<std::vector<unsigned int> >&);
+  static double getBiasAndForcesFromBasisValues(const std::vector<std::vector<double> >&, const std::vector<std::vector<double> >&, std::vector<double>&, std::vector<double>*, CoeffsVector*, const size_t, const size_t, std::vector<unsigned int>&);
   double getBiasAndForces(const std::vector<double>&, bool&, std::vector<double>&, std::vector<double>&);
   double getBiasAndForces(const std::vector<double>&, bool&, std::vector<double>&);
   double getBias(const std::vector<double>&, bool&, const bool parallel=true);
+  // separable (tensor product) evaluation of the bias and derivatives
+  double getBiasAndForcesSeparable(const std::vector<double>&, bool&, std::vector<double>&, std::vector<double>*);
+  double getBiasAndForcesFromBasisValuesSeparable(const std::vector<std::vector<double> >&, const std::vector<std::vector<double> >&, std::vector<double>&, std::vector<double>*, std::vector<double>&, std::vector<double>&) const;
+  // workspace vectors of the right size that can be used for the evaluation at each step
+  std::vector<double>& ArgsValuesWorkspace() {return args_values_ws_;}
+  std::vector<double>& ForcesWorkspace() {return forces_ws_;}
+  std::vector<double>& CoeffsDerivsValuesWorkspace() {return coeffsderivs_values_ws_;}
   //
   static void getBasisSetValues(const std::vector<double>&, std::vector<double>&, std::vector<BasisFunctions*>&, CoeffsVector*, Communicator* comm_in=NULL);
+  static void getBasisSetValues(const std::vector<double>&, std::vector<double>&, std::vector<BasisFunctions*>&, CoeffsVector*, Communicator*, std::vector<double>&, std::vector<std::vector<double> >&, std::vector<std::vector<double> >&, std::vector<unsigned int>&, std::vector<std::vector<unsigned int> >&);
+  static void getBasisSetValuesFromBasisValues(const std::vector<std::vector<double> >&, std::vector<double>&, CoeffsVector*, const size_t, const size_t, std::vector<unsigned int>&);
   void getBasisSetValues(const std::vector<double>&, std::vector<double>&, const bool parallel=true);
   //
   static double getBasisSetValue(const std::vector<double>&, const size_t, std::vector<BasisFunctions*>&, CoeffsVector*);
@@ -154,10 +193,12 @@ public:
   void writeFesGridToFile(OFile&, const bool append=false) const;
   //
   void setupFesProjGrid();
+  Grid getFesProjGrid(const std::vector<std::string>&) const;
   void writeFesProjGridToFile(const std::vector<std::string>&, OFile&, const bool append=false) const;
   //
   void writeTargetDistGridToFile(OFile&, const bool append=false) const;
   void writeLogTargetDistGridToFile(OFile&, const bool append=false) const;
+  Grid getTargetDistProjGrid(const std::vector<std::string>&) const;
   void writeTargetDistProjGridToFile(const std::vector<std::string>&, OFile&, const bool append=false) const;
   void writeTargetDistributionToFile(const std::string&) const;
   //
@@ -185,6 +226,8 @@ private:
   //
   Grid* setupGeneralGrid(const std::string&, const bool usederiv=false);
   //
+  void calculateBiasOnGrid(Grid*, const bool);
+  //
   void calculateTargetDistAveragesFromGrid(const Grid*);
   //
   bool isStaticTargetDistFileOutputActive() const;
@@ -193,26 +236,32 @@ private:
 
 inline
 double LinearBasisSetExpansion::getBiasAndForces(const std::vector<double>& args_values, bool& all_inside, std::vector<double>& forces, std::vector<double>& coeffsderivs_values) {
-  return getBiasAndForces(args_values,all_inside,forces,coeffsderivs_values,basisf_pntrs_, bias_coeffs_pntr_, &mycomm_);
+  if(separable_evaluation_) {
+    return getBiasAndForcesSeparable(args_values,all_inside,forces,&coeffsderivs_values);
+  }
+  return getBiasAndForces(args_values,all_inside,forces,coeffsderivs_values,basisf_pntrs_, bias_coeffs_pntr_, &mycomm_, args_values_trsfrm_, bf_values_, bf_derivs_, coeffs_indices_, omp_bias_, omp_forces_, omp_indices_);
 }
 
 
 inline
 double LinearBasisSetExpansion::getBiasAndForces(const std::vector<double>& args_values, bool& all_inside, std::vector<double>& forces) {
-  std::vector<double> coeffsderivs_values_dummy(ncoeffs_);
-  return getBiasAndForces(args_values,all_inside,forces,coeffsderivs_values_dummy,basisf_pntrs_, bias_coeffs_pntr_, &mycomm_);
+  if(separable_evaluation_) {
+    return getBiasAndForcesSeparable(args_values,all_inside,forces,NULL);
+  }
+  return getBiasAndForces(args_values,all_inside,forces,coeffsderivs_values_dummy_,basisf_pntrs_, bias_coeffs_pntr_, &mycomm_, args_values_trsfrm_, bf_values_, bf_derivs_, coeffs_indices_, omp_bias_, omp_forces_, omp_indices_);
 }
 
 
 inline
 double LinearBasisSetExpansion::getBias(const std::vector<double>& args_values, bool& all_inside, const bool parallel) {
-  std::vector<double> forces_dummy(nargs_);
-  std::vector<double> coeffsderivs_values_dummy(ncoeffs_);
+  if(separable_evaluation_) {
+    return getBiasAndForcesSeparable(args_values,all_inside,forces_dummy_,NULL);
+  }
   if(parallel) {
-    return getBiasAndForces(args_values,all_inside,forces_dummy,coeffsderivs_values_dummy,basisf_pntrs_, bias_coeffs_pntr_, &mycomm_);
+    return getBiasAndForces(args_values,all_inside,forces_dummy_,coeffsderivs_values_dummy_,basisf_pntrs_, bias_coeffs_pntr_, &mycomm_, args_values_trsfrm_, bf_values_, bf_derivs_, coeffs_indices_, omp_bias_, omp_forces_, omp_indices_);
   }
   else {
-    return getBiasAndForces(args_values,all_inside,forces_dummy,coeffsderivs_values_dummy,basisf_pntrs_, bias_coeffs_pntr_, NULL);
+    return getBiasAndForces(args_values,all_inside,forces_dummy_,coeffsderivs_values_dummy_,basisf_pntrs_, bias_coeffs_pntr_, NULL, args_values_trsfrm_, bf_values_, bf_derivs_, coeffs_indices_, omp_bias_, omp_forces_, omp_indices_);
   }
 }
 
@@ -220,10 +269,10 @@ double LinearBasisSetExpansion::getBias(const std::vector<double>& args_values,
 inline
 void LinearBasisSetExpansion::getBasisSetValues(const std::vector<double>& args_values, std::vector<double>& basisset_values, const bool parallel) {
   if(parallel) {
-    getBasisSetValues(args_values,basisset_values,basisf_pntrs_, bias_coeffs_pntr_, &mycomm_);
+    getBasisSetValues(args_values,basisset_values,basisf_pntrs_, bias_coeffs_pntr_, &mycomm_, args_values_trsfrm_, bf_values_, bf_derivs_, coeffs_indices_, omp_indices_);
   }
   else {
-    getBasisSetValues(args_values,basisset_values,basisf_pntrs_, bias_coeffs_pntr_, NULL);
+    getBasisSetValues(args_values,basisset_values,basisf_pntrs_, bias_coeffs_pntr_, NULL, args_values_trsfrm_, bf_values_, bf_derivs_, coeffs_indices_, omp_indices_);
   }
 }
 
@@ -25,6 +25,7 @@
 #include "CoeffsMatrix.h"
 #include "VesBias.h"
 #include "VesTools.h"
+#include "AsyncWriter.h"
 
 #include "tools/Exception.h"
 #include "core/PlumedMain.h"
@@ -33,6 +34,9 @@
 #include "tools/File.h"
 #include "tools/FileBase.h"
 
+#include <memory>
+#include <cstring>
+
 namespace PLMD {
 namespace ves {
 
@@ -88,7 +92,10 @@ Optimizer::Optimizer(const ActionOptions&ao):
   targetdist_output_stride_(0),
   targetdist_proj_output_active_(false),
   targetdist_proj_output_stride_(0),
-  isFirstStep(true)
+  isFirstStep(true),
+  async_writer_(NULL),
+  checkpoint_fname_(""),
+  checkpoint_wstride_(0)
 {
   std::vector<std::string> bias_labels(0);
   parseVector("BIAS",bias_labels);
@@ -200,6 +207,21 @@ Optimizer::Optimizer(const ActionOptions&ao):
     diagonal_hessian_ = !full_hessian;
   }
   //
+  bool async_output=false;
+  parseFlag("ASYNC_OUTPUT",async_output);
+  if(async_output) {
+    unsigned int async_output_queue=4;
+    parse("ASYNC_OUTPUT_QUEUE",async_output_queue);
+    if(async_output_queue==0) {plumed_merror(getName()+": ASYNC_OUTPUT_QUEUE should be larger than zero");}
+    async_writer_ = new AsyncWriter(async_output_queue);
+    if(async_writer_->isThreaded()) {
+      log.printf("  output files will be written in a background thread, at most %u output files can be waiting to be written\n",async_output_queue);
+    }
+    else {
+      log.printf("  ASYNC_OUTPUT has no effect as threads cannot be started, output files will be written directly\n");
+    }
+  }
+  //
   bool mw_single_files = false;
   if(keywords.exists("MULTIPLE_WALKERS")) {
     parseFlag("MULTIPLE_WALKERS",use_mwalkers_mpi_);
@@ -337,6 +359,20 @@ Optimizer::Optimizer(const ActionOptions&ao):
   }
   //
 
+  if(keywords.exists("CHECKPOINT_FILE")) {
+    parse("CHECKPOINT_FILE",checkpoint_fname_);
+    if(checkpoint_fname_.size()>0) {
+      checkpoint_fname_ = FileBase::appendSuffix(checkpoint_fname_,plumed.getSuffix());
+      parse("CHECKPOINT_OUTPUT",checkpoint_wstride_);
+      if(checkpoint_wstride_>0) {
+        log.printf("  the binary checkpoint file %s will be written every %u iterations and at the end of the simulation\n",checkpoint_fname_.c_str(),checkpoint_wstride_);
+      }
+      else {
+        log.printf("  the binary checkpoint file %s will be written at the end of the simulation\n",checkpoint_fname_.c_str());
+      }
+    }
+  }
+
   std::vector<std::string> coeffs_fnames;
   if(keywords.exists("COEFFS_FILE")) {
     parseFilenames("COEFFS_FILE",coeffs_fnames,"coeffs.data");
@@ -348,17 +384,22 @@ Optimizer::Optimizer(const ActionOptions&ao):
       }
     }
     if(getRestart()) {
-      for(unsigned int i=0; i<coeffs_fnames.size(); i++) {
-        IFile ifile;
-        ifile.link(*this);
-        if(use_mwalkers_mpi_) {ifile.enforceSuffix("");}
-        bool file_exist = ifile.FileExist(coeffs_fnames[i]);
-        if(!file_exist) {
-          std::string fname = FileBase::appendSuffix(coeffs_fnames[i],ifile.getSuffix());
-          plumed_merror("Cannot find coefficient file " + fname + " when trying to restart an optimzation. If you don't want to restart the optimzation please remove the RESTART keyword or use the RESTART=NO within the "+getName()+" action to locally disable the restart.");
+      if(checkpoint_fname_.size()>0 && isCheckpointFile(checkpoint_fname_)) {
+        readCheckpointFile();
+      }
+      else {
+        for(unsigned int i=0; i<coeffs_fnames.size(); i++) {
+          IFile ifile;
+          ifile.link(*this);
+          if(use_mwalkers_mpi_) {ifile.enforceSuffix("");}
+          bool file_exist = ifile.FileExist(coeffs_fnames[i]);
+          if(!file_exist) {
+            std::string fname = FileBase::appendSuffix(coeffs_fnames[i],ifile.getSuffix());
+            plumed_merror("Cannot find coefficient file " + fname + " when trying to restart an optimzation. If you don't want to restart the optimzation please remove the RESTART keyword or use the RESTART=NO within the "+getName()+" action to locally disable the restart.");
+          }
         }
+        readCoeffsFromFiles(coeffs_fnames,true);
       }
-      readCoeffsFromFiles(coeffs_fnames,true);
       comm.Barrier();
       if(comm.Get_rank()==0 && use_mwalkers_mpi_) {
         multi_sim_comm.Barrier();
@@ -772,6 +813,11 @@ Optimizer::~Optimizer() {
   else if(isTargetDistOutputActive() && getIterationCounter()%getTargetDistOutputStride()!=0) {
     writeTargetDistOutputFiles();
   }
+  if(checkpoint_fname_.size()>0) {
+    writeCheckpointFile();
+  }
+  // all the output files are written before they are closed
+  if(async_writer_!=NULL) {delete async_writer_;}
   //
   for(unsigned int i=0; i<aux_coeffs_pntrs_.size(); i++) {
     delete aux_coeffs_pntrs_[i];
@@ -862,6 +908,10 @@ void Optimizer::registerKeywords( Keywords& keys ) {
   keys.add("optional","BIAS_OUTPUT","how often the bias(es) should be written out to file. Note that the value is given in terms of coefficent iterations.");
   keys.add("optional","FES_OUTPUT","how often the FES(s) should be written out to file. Note that the value is given in terms of coefficent iterations.");
   keys.add("optional","FES_PROJ_OUTPUT","how often the projections of the FES(s) should be written out to file. Note that the value is given in terms of coefficent iterations.");
+  keys.addFlag("ASYNC_OUTPUT",false,"write the output files of the coefficients, bias, FES, and target distribution in a background thread such that the simulation does not need to wait for them. The data is copied when the output is done, so the files are identical to the ones written without this flag.");
+  keys.add("optional","CHECKPOINT_FILE","the name of a binary checkpoint file with the exact values of the coefficients and the averages sampled in the current iteration. The file is written at the end of the simulation and is used instead of the coefficient file(s) when restarting. It can be converted to and from the coefficient file format with the ves_checkpoint command line tool.");
+  keys.add("optional","CHECKPOINT_OUTPUT","how often the binary checkpoint file should be written in addition to the end of the simulation. This parameter is given as the number of iterations.");
+  keys.add("optional","ASYNC_OUTPUT_QUEUE","the maximum number of output files that can be waiting to be written in the background when using ASYNC_OUTPUT, the simulation waits if more files are written. By default it is 4.");
   //
   keys.reserve("optional","REWEIGHT_FACTOR_STRIDE","stride for updating the reweighting factor c(t). Note that the value is given in terms of coefficent iterations.");
   //
@@ -879,7 +929,7 @@ void Optimizer::registerKeywords( Keywords& keys ) {
 
 
 void Optimizer::useHessianKeywords(Keywords& keys) {
-  // keys.use("FULL_HESSIAN");
+  keys.use("FULL_HESSIAN");
   keys.use("HESSIAN_FILE");
   keys.use("HESSIAN_OUTPUT");
   keys.use("HESSIAN_FMT");
@@ -968,6 +1018,7 @@ void Optimizer::turnOffHessian() {
     bias_pntrs_[i]->disableHessian();
   }
   hessian_pntrs_.clear();
+  if(async_writer_!=NULL) {async_writer_->flush();}
   for(unsigned int i=0; i<hessianOFiles_.size(); i++) {
     hessianOFiles_[i]->close();
     delete hessianOFiles_[i];
@@ -1011,6 +1062,18 @@ std::vector<CoeffsMatrix*> Optimizer::enableHessian(VesBias* bias_pntr_in, const
 // }
 
 
+void Optimizer::runFinalJobs() {
+  // the output files still being written in the background are finished here,
+  // such that errors are reported before the end of the simulation
+  if(async_writer_!=NULL) {
+    try {async_writer_->flush();}
+    catch(const std::exception& e) {
+      plumed_merror(getName()+" "+getLabel()+": error in writing output files in the background: "+e.what());
+    }
+  }
+}
+
+
 void Optimizer::update() {
   if(onStep() && !isFirstStep) {
     for(unsigned int i=0; i<nbiases_; i++) {
@@ -1075,6 +1138,9 @@ void Optimizer::update() {
     if(isTargetDistProjOutputActive() && getIterationCounter()%getTargetDistProjOutputStride()==0) {
       writeTargetDistProjOutputFiles();
     }
+    if(checkpoint_fname_.size()>0 && checkpoint_wstride_>0 && getIterationCounter()%checkpoint_wstride_==0) {
+      writeCheckpointFile();
+    }
   }
   else {
     isFirstStep=false;
@@ -1120,6 +1186,7 @@ void Optimizer::updateOutputComponents() {
 
 
 void Optimizer::turnOffCoeffsOutputFiles() {
+  if(async_writer_!=NULL) {async_writer_->flush();}
   for(unsigned int i=0; i<coeffsOFiles_.size(); i++) {
     coeffsOFiles_[i]->close();
     delete coeffsOFiles_[i];
@@ -1129,6 +1196,10 @@ void Optimizer::turnOffCoeffsOutputFiles() {
 
 
 void Optimizer::writeOutputFiles(const unsigned int coeffs_id) {
+  if(async_writer_!=NULL) {
+    writeOutputFilesAsync(coeffs_id);
+    return;
+  }
   if(coeffsOFiles_.size()>0 && iter_counter%coeffs_wstride_==0) {
     coeffs_pntrs_[coeffs_id]->writeToFile(*coeffsOFiles_[coeffs_id],aux_coeffs_pntrs_[coeffs_id],false);
   }
@@ -1149,6 +1220,38 @@ void Optimizer::writeOutputFiles(const unsigned int coeffs_id) {
 }
 
 
+void Optimizer::writeOutputFilesAsync(const unsigned int coeffs_id) {
+  // the files are only written on the first rank, see setupOFiles
+  if(comm.Get_rank()>0) {return;}
+  if(coeffsOFiles_.size()>0 && iter_counter%coeffs_wstride_==0) {
+    std::shared_ptr<CoeffsVector> coeffs(new CoeffsVector(*coeffs_pntrs_[coeffs_id]));
+    std::shared_ptr<CoeffsVector> aux_coeffs(new CoeffsVector(*aux_coeffs_pntrs_[coeffs_id]));
+    OFile* ofile_pntr = coeffsOFiles_[coeffs_id];
+    async_writer_->submit([coeffs,aux_coeffs,ofile_pntr] {coeffs->writeToFile(*ofile_pntr,aux_coeffs.get(),false);});
+  }
+  if(gradientOFiles_.size()>0 && iter_counter%gradient_wstride_==0) {
+    std::shared_ptr<CoeffsVector> gradient(new CoeffsVector(*gradient_pntrs_[coeffs_id]));
+    std::shared_ptr<CoeffsVector> aver_gradient;
+    if(aver_gradient_pntrs_.size()>0) {aver_gradient.reset(new CoeffsVector(*aver_gradient_pntrs_[coeffs_id]));}
+    OFile* ofile_pntr = gradientOFiles_[coeffs_id];
+    async_writer_->submit([gradient,aver_gradient,ofile_pntr] {
+      if(!aver_gradient) {gradient->writeToFile(*ofile_pntr,false);}
+      else {gradient->writeToFile(*ofile_pntr,aver_gradient.get(),false);}
+    });
+  }
+  if(hessianOFiles_.size()>0 && iter_counter%hessian_wstride_==0) {
+    std::shared_ptr<CoeffsMatrix> hessian(new CoeffsMatrix(*hessian_pntrs_[coeffs_id]));
+    OFile* ofile_pntr = hessianOFiles_[coeffs_id];
+    async_writer_->submit([hessian,ofile_pntr] {hessian->writeToFile(*ofile_pntr);});
+  }
+  if(targetdist_averagesOFiles_.size()>0 && iter_counter%targetdist_averages_wstride_==0) {
+    std::shared_ptr<CoeffsVector> targetdist_averages(new CoeffsVector(*targetdist_averages_pntrs_[coeffs_id]));
+    OFile* ofile_pntr = targetdist_averagesOFiles_[coeffs_id];
+    async_writer_->submit([targetdist_averages,ofile_pntr] {targetdist_averages->writeToFile(*ofile_pntr);});
+  }
+}
+
+
 void Optimizer::setupOFiles(std::vector<std::string>& fnames, std::vector<OFile*>& OFiles, const bool multi_sim_single_files) {
   plumed_assert(ncoeffssets_>0);
   OFiles.resize(fnames.size(),NULL);
@@ -1163,6 +1266,20 @@ void Optimizer::setupOFiles(std::vector<std::string>& fnames, std::vector<OFile*
       OFiles[i]->enforceSuffix("");
     }
     OFiles[i]->open(fnames[i]);
+    if(async_writer_!=NULL) {
+      // the files are written in the background thread where the MPI calls of a
+      // linked file are not allowed, so they are reopened on the first rank
+      // without being linked once they have been created (or backed up) above
+      std::string path = OFiles[i]->getPath();
+      OFiles[i]->close();
+      delete OFiles[i];
+      // all ranks open the linked file, wait for them before it is reopened
+      comm.Barrier();
+      OFiles[i] = new OFile();
+      OFiles[i]->enforceRestart();
+      if(comm.Get_rank()>0) {path="/dev/null";}
+      OFiles[i]->open(path);
+    }
     OFiles[i]->setHeavyFlush();
   }
 }
@@ -1212,6 +1329,110 @@ void Optimizer::readCoeffsFromFiles(const std::vector<std::string>& fnames, cons
 }
 
 
+namespace {
+const char checkpoint_file_id[] = "PLUMED_VES_CHECKPOINT";
+const unsigned int checkpoint_file_version = 1;
+}
+
+
+void Optimizer::writeCheckpointHeader(std::FILE* fp, const unsigned int ncoeffssets) {
+  if(std::fwrite(checkpoint_file_id,sizeof(char),sizeof(checkpoint_file_id),fp)!=sizeof(checkpoint_file_id)) {
+    plumed_merror("error in writing to binary file");
+  }
+  VesTools::writeBinary(fp,checkpoint_file_version);
+  VesTools::writeBinary(fp,ncoeffssets);
+}
+
+
+unsigned int Optimizer::readCheckpointHeader(std::FILE* fp, const std::string& fname) {
+  char file_id[sizeof(checkpoint_file_id)];
+  if(std::fread(file_id,sizeof(char),sizeof(file_id),fp)!=sizeof(file_id) || std::memcmp(file_id,checkpoint_file_id,sizeof(file_id))!=0) {
+    plumed_merror("the file " + fname + " is not a VES checkpoint file");
+  }
+  unsigned int version = 0;
+  VesTools::readBinary(fp,version);
+  if(version!=checkpoint_file_version) {
+    std::string s1; Tools::convert(version,s1);
+    plumed_merror("the VES checkpoint file " + fname + " has version " + s1 + " that is not supported");
+  }
+  unsigned int ncoeffssets = 0;
+  VesTools::readBinary(fp,ncoeffssets);
+  return ncoeffssets;
+}
+
+
+bool Optimizer::isCheckpointFile(const std::string& fname) {
+  std::FILE* fp = std::fopen(fname.c_str(),"rb");
+  if(fp==NULL) {return false;}
+  char file_id[sizeof(checkpoint_file_id)];
+  bool is_checkpoint = std::fread(file_id,sizeof(char),sizeof(file_id),fp)==sizeof(file_id) && std::memcmp(file_id,checkpoint_file_id,sizeof(file_id))==0;
+  std::fclose(fp);
+  return is_checkpoint;
+}
+
+
+void Optimizer::writeCheckpointFile() {
+  // the checkpoint is first written to a temporary file that then replaces
+  // the old one, so a complete checkpoint file exists at all times
+  std::string tmp_fname = checkpoint_fname_ + ".tmp";
+  std::FILE* fp = NULL;
+  if(comm.Get_rank()==0) {
+    fp = std::fopen(tmp_fname.c_str(),"wb");
+    if(fp==NULL) {plumed_merror(getName()+" "+getLabel()+": cannot open the checkpoint file "+tmp_fname+" for writing");}
+    writeCheckpointHeader(fp,ncoeffssets_);
+  }
+  // the coefficient sets of each bias are stored in the same order as in coeffs_pntrs_
+  unsigned int i=0;
+  for(unsigned int b=0; b<nbiases_; b++) {
+    for(unsigned int k=0; k<bias_pntrs_[b]->numberOfCoeffsSets(); k++, i++) {
+      if(fp!=NULL) {
+        coeffs_pntrs_[i]->writeToBinaryFile(fp);
+        aux_coeffs_pntrs_[i]->writeToBinaryFile(fp);
+        unsigned int has_aver_gradient = aver_gradient_pntrs_.size()>0 ? 1 : 0;
+        VesTools::writeBinary(fp,has_aver_gradient);
+        if(has_aver_gradient) {aver_gradient_pntrs_[i]->writeToBinaryFile(fp);}
+      }
+      bias_pntrs_[b]->writeSampledAveragesToBinaryFile(fp,k);
+    }
+  }
+  if(fp!=NULL) {
+    std::fclose(fp);
+    if(std::rename(tmp_fname.c_str(),checkpoint_fname_.c_str())!=0) {
+      plumed_merror(getName()+" "+getLabel()+": cannot rename "+tmp_fname+" to "+checkpoint_fname_);
+    }
+  }
+  comm.Barrier();
+}
+
+
+void Optimizer::readCheckpointFile() {
+  std::FILE* fp = std::fopen(checkpoint_fname_.c_str(),"rb");
+  if(fp==NULL) {plumed_merror(getName()+" "+getLabel()+": cannot open the checkpoint file "+checkpoint_fname_);}
+  unsigned int ncoeffssets = readCheckpointHeader(fp,checkpoint_fname_);
+  if(ncoeffssets!=ncoeffssets_) {
+    plumed_merror(getName()+" "+getLabel()+": the number of coefficient sets in the checkpoint file "+checkpoint_fname_+" does not match the number of coefficient sets that are optimized");
+  }
+  unsigned int i=0;
+  for(unsigned int b=0; b<nbiases_; b++) {
+    for(unsigned int k=0; k<bias_pntrs_[b]->numberOfCoeffsSets(); k++, i++) {
+      coeffs_pntrs_[i]->readFromBinaryFile(fp);
+      aux_coeffs_pntrs_[i]->readFromBinaryFile(fp);
+      unsigned int has_aver_gradient = 0;
+      VesTools::readBinary(fp,has_aver_gradient);
+      if(has_aver_gradient && aver_gradient_pntrs_.size()>0) {
+        aver_gradient_pntrs_[i]->readFromBinaryFile(fp);
+      }
+      else if(has_aver_gradient) {
+        delete CoeffsVector::createFromBinaryFile(fp,comm);
+      }
+      bias_pntrs_[b]->readSampledAveragesFromBinaryFile(fp,k);
+    }
+  }
+  std::fclose(fp);
+  log.printf("  Read in coefficents and sampled averages from checkpoint file %s\n",checkpoint_fname_.c_str());
+}
+
+
 void Optimizer::addCoeffsSetIDsToFilenames(std::vector<std::string>& fnames, std::string& coeffssetid_prefix) {
   if(ncoeffssets_==1) {return;}
   //
@@ -30,6 +30,7 @@
 #include <vector>
 #include <string>
 #include <cmath>
+#include <cstdio>
 
 
 #define PLUMED_VES_OPTIMIZER_INIT(ao) Action(ao),Optimizer(ao)
@@ -47,6 +48,7 @@ namespace ves {
 
 class CoeffsVector;
 class VesBias;
+class AsyncWriter;
 
 
 class Optimizer :
@@ -122,10 +124,18 @@ private:
   //
   bool isFirstStep;
   //
+  AsyncWriter* async_writer_;
+  //
+  std::string checkpoint_fname_;
+  unsigned int checkpoint_wstride_;
+  //
 private:
   void updateOutputComponents();
   void writeOutputFiles(const unsigned int coeffs_id = 0);
+  void writeOutputFilesAsync(const unsigned int coeffs_id = 0);
   void readCoeffsFromFiles(const std::vector<std::string>&, const bool);
+  void writeCheckpointFile();
+  void readCheckpointFile();
   void setAllCoeffsSetIterationCounters();
 protected:
   void turnOnHessian();
@@ -191,6 +201,7 @@ public:
   void apply() {};
   void calculate() {};
   void update();
+  void runFinalJobs();
   unsigned int getNumberOfDerivatives() {return 0;}
   //
   bool fixedStepSize() const {return fixed_stepsize_;}
@@ -234,6 +245,11 @@ public:
   void setTargetDistProjOutputStride(unsigned int stride) {targetdist_proj_output_stride_=stride;}
   void writeTargetDistProjOutputFiles() const;
   //
+  AsyncWriter* getAsyncWriter() const {return async_writer_;}
+  // header of the binary checkpoint files, readCheckpointHeader returns the number of coefficient sets
+  static void writeCheckpointHeader(std::FILE*, const unsigned int);
+  static unsigned int readCheckpointHeader(std::FILE*, const std::string&);
+  static bool isCheckpointFile(const std::string&);
 };
 
 inline
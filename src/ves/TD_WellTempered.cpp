@@ -147,15 +147,16 @@ void TD_WellTempered::updateGrid() {
   double beta_prime = getBeta()/bias_factor_;
   plumed_massert(getFesGridPntr()!=NULL,"the FES grid has to be linked to use TD_WellTempered!");
   std::vector<double> integration_weights = GridIntegrationWeights::getIntegrationWeights(getTargetDistGridPntr());
+  const Grid& fes_grid = *getFesGridPntr();
+  logTargetDistGrid().mapValues([&](Grid::index_t l, double) {return beta_prime * fes_grid.getValue(l);});
+  const Grid& log_targetdist_grid = logTargetDistGrid();
   double norm = 0.0;
-  for(Grid::index_t l=0; l<targetDistGrid().getSize(); l++) {
-    double value = beta_prime * getFesGridPntr()->getValue(l);
-    logTargetDistGrid().setValue(l,value);
-    value = exp(-value);
+  targetDistGrid().mapValues([&](Grid::index_t l, double) {
+    double value = exp(-log_targetdist_grid.getValue(l));
     norm += integration_weights[l]*value;
-    targetDistGrid().setValue(l,value);
-  }
-  targetDistGrid().scaleAllValuesAndDerivatives(1.0/norm);
+    return value;
+  });
+  targetDistGrid().scaleAll(1.0/norm);
   logTargetDistGrid().setMinToZero();
 }
 
@@ -28,12 +28,18 @@
 #include "FermiSwitchingFunction.h"
 #include "VesTools.h"
 #include "TargetDistribution.h"
+#include "AsyncWriter.h"
 
 #include "tools/Communicator.h"
 #include "core/ActionSet.h"
 #include "core/PlumedMain.h"
 #include "core/Atoms.h"
 #include "tools/File.h"
+#include "tools/Grid.h"
+#include "blas/blas.h"
+
+#include <algorithm>
+#include <memory>
 
 
 namespace PLMD {
@@ -60,6 +66,15 @@ VesBias::VesBias(const ActionOptions&ao):
   compute_hessian_(false),
   diagonal_hessian_(true),
   aver_counters(0),
+  averages_batch_size_(1),
+  sampled_values_buffer_(0),
+  nbuffered_samples_(0),
+  batch_sums_(0),
+  batch_ones_(0),
+  restore_sampled_averages_(false),
+  restored_averages_(0),
+  restored_cross_averages_(0),
+  restored_aver_counters_(0),
   kbt_(0.0),
   targetdist_pntrs_(0),
   dynamic_targetdist_(false),
@@ -107,6 +122,14 @@ VesBias::VesBias(const ActionOptions&ao):
     parseVector("COEFFS",coeffs_fnames);
   }
 
+  parse("AVERAGES_BATCH_SIZE",averages_batch_size_);
+  if(averages_batch_size_==0) {
+    plumed_merror("the value given in AVERAGES_BATCH_SIZE should be larger than 0");
+  }
+  if(averages_batch_size_>1) {
+    log.printf("  the sampled averages are updated in batches of %u samples\n",averages_batch_size_);
+  }
+
 
   if(keywords.exists("ARG_SET") && !keywords.exists("ARG")) {
     std::vector<Value*> arg;
@@ -298,6 +321,7 @@ void VesBias::registerKeywords( Keywords& keys ) {
   Bias::registerKeywords(keys);
   keys.reserve("numbered","ARG_SET","similar as ARG for other biases but allows to define different argument sets that will be used");
   keys.add("optional","TEMP","the system temperature - this is needed if the MD code does not pass the temperature to PLUMED.");
+  keys.add("compulsory","AVERAGES_BATCH_SIZE","1","the number of samples that are collected before they are added to the averages needed for the optimization of the coefficients. Larger values (e.g. 16) reduce the cost of each step, in particular when using the full Hessian, but change the order in which the samples are summed, so results can differ in the last digits.");
   //
   keys.reserve("optional","COEFFS","read in the coefficents from files.");
   //
@@ -432,6 +456,12 @@ void VesBias::initializeCoeffs(CoeffsVector* coeffs_pntr_in) {
   sampled_cross_averages.push_back(cross_aver_sampled_tmp);
   //
   aver_counters.push_back(0);
+  sampled_values_buffer_.push_back(std::vector<double>(averages_batch_size_*coeffs_pntr_in->numberOfCoeffs(),0.0));
+  nbuffered_samples_.push_back(0);
+  if(batch_sums_.size()<coeffs_pntr_in->numberOfCoeffs()) {
+    batch_sums_.assign(coeffs_pntr_in->numberOfCoeffs(),0.0);
+  }
+  batch_ones_.assign(averages_batch_size_,1.0);
   //
   ncoeffssets_++;
 }
@@ -474,8 +504,10 @@ bool VesBias::readCoeffsFromFiles() {
 
 
 void VesBias::updateGradientAndHessian(const bool use_mwalkers_mpi) {
+  if(restore_sampled_averages_) {restoreSampledAverages();}
   for(unsigned int k=0; k<ncoeffssets_; k++) {
     //
+    addBufferedSamplesToAverages(k);
     comm.Sum(sampled_averages[k]);
     comm.Sum(sampled_cross_averages[k]);
     unsigned int total_samples = aver_counters[k];
@@ -541,35 +573,154 @@ void VesBias::multiSimSumAverages(const unsigned int c_id, const double walker_w
 
 
 void VesBias::addToSampledAverages(const std::vector<double>& values, const unsigned int c_id) {
+  // the values are only added to the buffer, the averages are updated once
+  // averages_batch_size_ samples have been collected or when they are needed
+  // only the block of coefficients of this rank is needed (see LinearBasisSetExpansion::getBiasAndForces)
+  if(restore_sampled_averages_) {restoreSampledAverages();}
+  size_t begin, end;
+  VesTools::getBlockOfIndices(numberOfCoeffs(c_id),comm.Get_rank(),comm.Get_size(),begin,end);
+  std::vector<double>& buffer = sampled_values_buffer_[c_id];
+  const size_t k = nbuffered_samples_[c_id];
+  for(size_t i=begin; i<end; i++) {
+    buffer[i*averages_batch_size_+k] = values[i];
+  }
+  nbuffered_samples_[c_id]++;
+  aver_counters[c_id] += 1;
+  if(nbuffered_samples_[c_id]==averages_batch_size_) {
+    addBufferedSamplesToAverages(c_id);
+  }
+}
+
+
+void VesBias::addBufferedSamplesToAverages(const unsigned int c_id) {
   /*
-  use the following online equation to calculate the average and covariance
-  (see https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Covariance)
+  the average of the K buffered samples is merged with the average of the
+  previous n samples (see https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance#Parallel_algorithm)
+      xm[n+K] = xm[n] + (xb-xm[n])*K/(n+K)
+  where xb is the average of the buffered samples. For K=1 this is the
+  same as the online update
       xm[n+1] = xm[n] + (x[n+1]-xm[n])/(n+1)
+  The full Hessian is updated with a single rank-K update
+      xm[n+K] = n/(n+K)*xm[n] + 1/(n+K)*sum_k x[n+k]*x[n+k]^T
   */
-  double counter_dbl = static_cast<double>(aver_counters[c_id]);
-  size_t ncoeffs = numberOfCoeffs(c_id);
-  std::vector<double> deltas(ncoeffs,0.0);
-  size_t stride = comm.Get_size();
-  size_t rank = comm.Get_rank();
-  // update average and diagonal part of Hessian
-  for(size_t i=rank; i<ncoeffs; i+=stride) {
-    size_t midx = getHessianIndex(i,i,c_id);
-    deltas[i] = (values[i]-sampled_averages[c_id][i])/(counter_dbl+1); // (x[n+1]-xm[n])/(n+1)
-    sampled_averages[c_id][i] += deltas[i];
-    sampled_cross_averages[c_id][midx] += (values[i]*values[i]-sampled_cross_averages[c_id][midx])/(counter_dbl+1);
-  }
-  comm.Sum(deltas);
-  // update off-diagonal part of the Hessian
-  if(!diagonal_hessian_) {
-    for(size_t i=rank; i<ncoeffs; i+=stride) {
-      for(size_t j=(i+1); j<ncoeffs; j++) {
-        size_t midx = getHessianIndex(i,j,c_id);
-        sampled_cross_averages[c_id][midx] += (values[i]*values[j]-sampled_cross_averages[c_id][midx])/(counter_dbl+1);
+  const unsigned int nbuffered = nbuffered_samples_[c_id];
+  if(nbuffered==0) {return;}
+  const size_t stride = comm.Get_size();
+  const size_t rank = comm.Get_rank();
+  size_t begin, end;
+  VesTools::getBlockOfIndices(numberOfCoeffs(c_id),rank,stride,begin,end);
+  std::vector<double>& buffer = sampled_values_buffer_[c_id];
+  const double nbuffered_dbl = static_cast<double>(nbuffered);
+  const double counter_dbl = static_cast<double>(aver_counters[c_id]);
+  const double counter_before_dbl = static_cast<double>(aver_counters[c_id]-nbuffered);
+  //
+  if(begin<end) {
+    // the sums of the buffered values of the coefficients of this rank
+    int m = nbuffered;
+    int n = end-begin;
+    int lda = averages_batch_size_;
+    int one = 1;
+    double alpha = 1.0;
+    double beta = 0.0;
+    plumed_blas_dgemv("T",&m,&n,&alpha,&buffer[begin*averages_batch_size_],&lda,&batch_ones_[0],&one,&beta,&batch_sums_[begin],&one);
+    for(size_t i=begin; i<end; i++) {
+      sampled_averages[c_id][i] += (batch_sums_[i]/nbuffered_dbl-sampled_averages[c_id][i])*nbuffered_dbl/(counter_before_dbl+nbuffered_dbl);
+    }
+    if(diagonal_hessian_) {
+      for(size_t i=begin; i<end; i++) {
+        double* x = &buffer[i*averages_batch_size_];
+        double sum_sq = plumed_blas_ddot(&m,x,&one,x,&one);
+        size_t midx = getHessianIndex(i,i,c_id);
+        sampled_cross_averages[c_id][midx] += (sum_sq/nbuffered_dbl-sampled_cross_averages[c_id][midx])*nbuffered_dbl/(counter_before_dbl+nbuffered_dbl);
       }
     }
   }
+  if(!diagonal_hessian_) {
+    // each row of the full Hessian needs the values of all the coefficients,
+    // so the buffer is summed over the ranks once for each batch
+    if(stride>1) {comm.Sum(buffer);}
+    hessian_pntrs_[c_id]->symmetricRankUpdate(sampled_cross_averages[c_id],buffer,nbuffered,averages_batch_size_,1.0/counter_dbl,counter_before_dbl/counter_dbl,rank,stride);
+    if(stride>1) {std::fill(buffer.begin(),buffer.end(),0.0);}
+  }
   // NOTE: the MPI sum for sampled_averages and sampled_cross_averages is done later
-  aver_counters[c_id] += 1;
+  nbuffered_samples_[c_id]=0;
+}
+
+
+void VesBias::writeSampledAveragesToBinaryFile(std::FILE* fp, const unsigned int c_id) {
+  // the averages are written in a form that does not depend on the number of
+  // ranks, so the buffered samples are added and the blocks of all ranks summed
+  if(restore_sampled_averages_) {restoreSampledAverages();}
+  addBufferedSamplesToAverages(c_id);
+  std::vector<double> averages = sampled_averages[c_id];
+  std::vector<double> cross_averages = sampled_cross_averages[c_id];
+  comm.Sum(averages);
+  comm.Sum(cross_averages);
+  if(fp!=NULL) {
+    VesTools::writeBinary(fp,aver_counters[c_id]);
+    VesTools::writeBinary(fp,averages);
+    VesTools::writeBinary(fp,cross_averages);
+  }
+}
+
+
+void VesBias::readSampledAveragesFromBinaryFile(std::FILE* fp, const unsigned int c_id) {
+  restored_averages_.resize(ncoeffssets_);
+  restored_cross_averages_.resize(ncoeffssets_);
+  restored_aver_counters_.resize(ncoeffssets_,0);
+  VesTools::readBinary(fp,restored_aver_counters_[c_id]);
+  VesTools::readBinary(fp,restored_averages_[c_id]);
+  VesTools::readBinary(fp,restored_cross_averages_[c_id]);
+  // nothing has been sampled in the current iteration, the averages are not needed
+  if(restored_aver_counters_[c_id]==0) {
+    restored_averages_[c_id].clear();
+    restored_cross_averages_[c_id].clear();
+    return;
+  }
+  plumed_massert(restored_averages_[c_id].size()==numberOfCoeffs(c_id),"Error when reading in the sampled averages from binary file: wrong number of coeffs");
+  restore_sampled_averages_ = true;
+}
+
+
+void VesBias::restoreSampledAverages() {
+  // each rank only keeps the part of the averages that it updates itself,
+  // see addToSampledAverages and addBufferedSamplesToAverages
+  const size_t stride = comm.Get_size();
+  const size_t rank = comm.Get_rank();
+  for(unsigned int k=0; k<restored_averages_.size(); k++) {
+    if(restored_averages_[k].size()==0) {continue;}
+    if(restored_cross_averages_[k].size()!=sampled_cross_averages[k].size()) {
+      plumed_merror("VES bias " + getLabel() + ": the sampled averages read from the checkpoint file were obtained with a different type of Hessian (diagonal or full) than is used now");
+    }
+    size_t ncoeffs = numberOfCoeffs(k);
+    size_t begin, end;
+    VesTools::getBlockOfIndices(ncoeffs,rank,stride,begin,end);
+    std::fill(sampled_averages[k].begin(), sampled_averages[k].end(), 0.0);
+    std::fill(sampled_cross_averages[k].begin(), sampled_cross_averages[k].end(), 0.0);
+    for(size_t i=begin; i<end; i++) {
+      sampled_averages[k][i] = restored_averages_[k][i];
+    }
+    if(diagonal_hessian_) {
+      for(size_t i=begin; i<end; i++) {
+        size_t midx = getHessianIndex(i,i,k);
+        sampled_cross_averages[k][midx] = restored_cross_averages_[k][midx];
+      }
+    }
+    else {
+      for(size_t i=rank; i<ncoeffs; i+=stride) {
+        for(size_t j=i; j<ncoeffs; j++) {
+          size_t midx = getHessianIndex(i,j,k);
+          sampled_cross_averages[k][midx] = restored_cross_averages_[k][midx];
+        }
+      }
+    }
+    aver_counters[k] = restored_aver_counters_[k];
+    nbuffered_samples_[k] = 0;
+  }
+  restored_averages_.clear();
+  restored_cross_averages_.clear();
+  restored_aver_counters_.clear();
+  restore_sampled_averages_ = false;
 }
 
 
@@ -627,6 +778,7 @@ void VesBias::linkOptimizer(Optimizer* optimizer_pntr_in) {
 
 
 void VesBias::enableHessian(const bool diagonal_hessian) {
+  for(unsigned int i=0; i<ncoeffssets_; i++) {addBufferedSamplesToAverages(i);}
   compute_hessian_=true;
   diagonal_hessian_=diagonal_hessian;
   sampled_cross_averages.clear();
@@ -643,6 +795,7 @@ void VesBias::enableHessian(const bool diagonal_hessian) {
 
 
 void VesBias::disableHessian() {
+  for(unsigned int i=0; i<ncoeffssets_; i++) {addBufferedSamplesToAverages(i);}
   compute_hessian_=false;
   diagonal_hessian_=true;
   sampled_cross_averages.clear();
@@ -691,6 +844,30 @@ OFile* VesBias::getOFile(const std::string& filepath, const bool multi_sim_singl
 }
 
 
+void VesBias::writeGridToFile(Grid* grid_pntr, const std::string& filepath, const bool multi_sim_single_file) {
+  OFile* ofile_pntr = getOFile(filepath,multi_sim_single_file);
+  AsyncWriter* async_writer = optimizer_pntr_!=NULL ? optimizer_pntr_->getAsyncWriter() : NULL;
+  if(grid_pntr==NULL || async_writer==NULL) {
+    if(grid_pntr!=NULL) {grid_pntr->writeToFile(*ofile_pntr);}
+    ofile_pntr->close(); delete ofile_pntr;
+    return;
+  }
+  // the file has been created (or backed up) above, the grid is copied and
+  // written to it on the first rank by the background thread using a file
+  // that is not linked as the MPI calls of a linked file are not allowed there
+  std::string path = ofile_pntr->getPath();
+  ofile_pntr->close(); delete ofile_pntr;
+  // all ranks open the linked file, wait for them before it is reopened
+  comm.Barrier();
+  if(comm.Get_rank()>0 || path=="/dev/null") {return;}
+  std::shared_ptr<Grid> grid_copy(new Grid(*grid_pntr));
+  std::shared_ptr<OFile> ofile(new OFile());
+  ofile->enforceRestart();
+  ofile->open(path);
+  async_writer->submit([grid_copy,ofile] {grid_copy->writeToFile(*ofile); ofile->close();});
+}
+
+
 void VesBias::setGridBins(const std::vector<unsigned int>& grid_bins_in) {
   plumed_massert(grid_bins_in.size()==getNumberOfArgumentsPerSet(),"the number of grid bins given doesn't match the number of arguments");
   grid_bins_=grid_bins_in;
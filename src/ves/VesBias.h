@@ -33,6 +33,7 @@
 #include <vector>
 #include <string>
 #include <cmath>
+#include <cstdio>
 
 
 #define PLUMED_VES_VESBIAS_INIT(ao) Action(ao),VesBias(ao)
@@ -40,6 +41,7 @@
 namespace PLMD {
 
 class Value;
+class Grid;
 
 namespace ves {
 
@@ -84,6 +86,19 @@ private:
   bool diagonal_hessian_;
   //
   std::vector<unsigned int> aver_counters;
+  // the sampled values are buffered and added to the averages in batches,
+  // the k-th buffered sample of coefficient i is stored at [i*averages_batch_size_+k]
+  unsigned int averages_batch_size_;
+  std::vector<std::vector<double> > sampled_values_buffer_;
+  std::vector<unsigned int> nbuffered_samples_;
+  std::vector<double> batch_sums_;
+  std::vector<double> batch_ones_;
+  // averaging state read from a checkpoint file, it is only used once the
+  // optimizer has set up the Hessian (see restoreSampledAverages)
+  bool restore_sampled_averages_;
+  std::vector<std::vector<double> > restored_averages_;
+  std::vector<std::vector<double> > restored_cross_averages_;
+  std::vector<unsigned int> restored_aver_counters_;
   //
   double kbt_;
   //
@@ -125,6 +140,8 @@ private:
 private:
   void initializeCoeffs(CoeffsVector*);
   std::vector<double> computeCovarianceFromAverages(const unsigned int) const;
+  void addBufferedSamplesToAverages(const unsigned int);
+  void restoreSampledAverages();
   void multiSimSumAverages(const unsigned int, const double walker_weight=1.0);
 protected:
   //
@@ -212,6 +229,9 @@ public:
   //
   void updateGradientAndHessian(const bool);
   void clearGradientAndHessian() {};
+  // binary input/output of the averaging state, the writing is collective and only done if the file pointer is given
+  void writeSampledAveragesToBinaryFile(std::FILE*, const unsigned int c_id = 0);
+  void readSampledAveragesFromBinaryFile(std::FILE*, const unsigned int c_id = 0);
   //
   virtual void updateTargetDistributions() {};
   virtual void restartTargetDistributions() {};
@@ -286,6 +306,8 @@ public:
   void applyBiasCutoff(double&, std::vector<double>&, std::vector<double>&) const;
   //
   OFile* getOFile(const std::string& filename, const bool multi_sim_single_file=false, const bool enforce_backup=true);
+  // write a grid to file, in the background if the optimizer uses ASYNC_OUTPUT (an empty file is written for NULL)
+  void writeGridToFile(Grid*, const std::string& filename, const bool multi_sim_single_file=false);
   //
   virtual void setupBiasFileOutput() {};
   virtual void writeBiasToFile() {};
@@ -373,21 +395,9 @@ void VesBias::applyBiasCutoff(double& bias, std::vector<double>& forces, std::ve
 
 inline
 std::vector<double> VesBias::computeCovarianceFromAverages(const unsigned int c_id) const {
-  size_t ncoeffs = numberOfCoeffs(c_id);
-  std::vector<double> covariance(sampled_cross_averages[c_id].size(),0.0);
-  // diagonal part
-  for(size_t i=0; i<ncoeffs; i++) {
-    size_t midx = getHessianIndex(i,i,c_id);
-    covariance[midx] = sampled_cross_averages[c_id][midx] - sampled_averages[c_id][i]*sampled_averages[c_id][i];
-  }
-  if(!diagonal_hessian_) {
-    for(size_t i=0; i<ncoeffs; i++) {
-      for(size_t j=(i+1); j<ncoeffs; j++) {
-        size_t midx = getHessianIndex(i,j,c_id);
-        covariance[midx] = sampled_cross_averages[c_id][midx] - sampled_averages[c_id][i]*sampled_averages[c_id][j];
-      }
-    }
-  }
+  // covariance = cross_averages - averages*averages^T
+  std::vector<double> covariance(sampled_cross_averages[c_id]);
+  hessian_pntrs_[c_id]->symmetricRankUpdate(covariance,sampled_averages[c_id],1,1,-1.0,1.0);
   return covariance;
 }
 
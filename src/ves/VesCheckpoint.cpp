@@ -0,0 +1,239 @@
+/* +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
+   Copyright (c) 2016-2018 The VES code team
+   (see the PEOPLE-VES file at the root of this folder for a list of names)
+
+   See http://www.ves-code.org for more information.
+
+   This file is part of VES code module.
+
+   The VES code module is free software: you can redistribute it and/or modify
+   it under the terms of the GNU Lesser General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   The VES code module is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU Lesser General Public License for more details.
+
+   You should have received a copy of the GNU Lesser General Public License
+   along with the VES code module.  If not, see <http://www.gnu.org/licenses/>.
++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++ */
+
+#include "CoeffsVector.h"
+#include "Optimizer.h"
+#include "VesTools.h"
+
+#include "cltools/CLTool.h"
+#include "cltools/CLToolRegister.h"
+#include "tools/Communicator.h"
+#include "tools/File.h"
+#include "tools/FileBase.h"
+#include "tools/Tools.h"
+
+#include <string>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+
+namespace PLMD {
+namespace ves {
+
+//+PLUMEDOC VES_TOOLS ves_checkpoint
+/*
+Convert binary VES checkpoint files to and from the coefficient file format.
+
+The binary checkpoint files written by the optimizers when using the CHECKPOINT_FILE
+keyword contain the exact values of the coefficients and of the averages
+sampled in the current iteration. This command line tool can be used to convert
+such a file into a coefficient file in the same format as the ones given by the
+COEFFS_FILE keyword. If the checkpoint file contains multiple coefficient sets
+a separate file is written for each set and the id of the set is added to
+the filename in the same way as done by the optimizers.
+
+It is also possible to convert a coefficient file into a checkpoint file
+that can be used to restart an optimization. Only the last set of coefficients
+in the file is used and the sampled averages are then empty.
+
+The direction of the conversion is determined from the file given by
+the --input keyword.
+
+\par Examples
+
+The following command converts the checkpoint file checkpoint.data into the
+coefficient file coeffs.data
+\verbatim
+plumed ves_checkpoint --input checkpoint.data --output coeffs.data
+\endverbatim
+
+while the following command converts the coefficient file coeffs.data into
+the checkpoint file checkpoint.data
+\verbatim
+plumed ves_checkpoint --input coeffs.data --output checkpoint.data
+\endverbatim
+
+*/
+//+ENDPLUMEDOC
+
+class VesCheckpoint : public PLMD::CLTool {
+public:
+  std::string description() const {return "convert binary VES checkpoint files to and from the coefficient file format";}
+  static void registerKeywords( Keywords& keys );
+  explicit VesCheckpoint( const CLToolOptions& co );
+  int main( FILE* in, FILE* out, PLMD::Communicator& pc);
+private:
+  void convertCheckpointToCoeffsFiles(const std::string&, const std::string&, FILE*, Communicator&);
+  void convertCoeffsFileToCheckpoint(const std::string&, const std::string&, FILE*, Communicator&);
+};
+
+PLUMED_REGISTER_CLTOOL(VesCheckpoint,"ves_checkpoint")
+
+void VesCheckpoint::registerKeywords( Keywords& keys ) {
+  CLTool::registerKeywords( keys );
+  keys.add("compulsory","--input","the name of the checkpoint or coefficient file that should be converted");
+  keys.add("compulsory","--output","the name of the coefficient or checkpoint file that should be written");
+}
+
+
+VesCheckpoint::VesCheckpoint( const CLToolOptions& co ):
+  CLTool(co)
+{
+  inputdata=commandline;
+}
+
+
+int VesCheckpoint::main( FILE* in, FILE* out, PLMD::Communicator& pc) {
+  std::string input_fname;
+  parse("--input",input_fname);
+  std::string output_fname;
+  parse("--output",output_fname);
+  if(Optimizer::isCheckpointFile(input_fname)) {
+    convertCheckpointToCoeffsFiles(input_fname,output_fname,out,pc);
+  }
+  else {
+    convertCoeffsFileToCheckpoint(input_fname,output_fname,out,pc);
+  }
+  return 0;
+}
+
+
+void VesCheckpoint::convertCheckpointToCoeffsFiles(const std::string& input_fname, const std::string& output_fname, FILE* out, Communicator& pc) {
+  std::FILE* fp = std::fopen(input_fname.c_str(),"rb");
+  if(fp==NULL) {plumed_merror("cannot open the checkpoint file "+input_fname);}
+  unsigned int ncoeffssets = Optimizer::readCheckpointHeader(fp,input_fname);
+  for(unsigned int i=0; i<ncoeffssets; i++) {
+    CoeffsVector* coeffs_pntr = CoeffsVector::createFromBinaryFile(fp,pc);
+    CoeffsVector* aux_coeffs_pntr = CoeffsVector::createFromBinaryFile(fp,pc);
+    // the averaged gradient and the sampled averages are not part of the coefficient files
+    unsigned int has_aver_gradient = 0;
+    VesTools::readBinary(fp,has_aver_gradient);
+    if(has_aver_gradient) {delete CoeffsVector::createFromBinaryFile(fp,pc);}
+    unsigned int aver_counter = 0;
+    std::vector<double> averages;
+    std::vector<double> cross_averages;
+    VesTools::readBinary(fp,aver_counter);
+    VesTools::readBinary(fp,averages);
+    VesTools::readBinary(fp,cross_averages);
+    //
+    std::string fname = output_fname;
+    if(ncoeffssets>1) {
+      std::string is; Tools::convert(i,is);
+      fname = FileBase::appendSuffix(output_fname,".c-"+is);
+    }
+    OFile ofile;
+    ofile.link(pc);
+    ofile.open(fname);
+    coeffs_pntr->writeToFile(ofile,aux_coeffs_pntr,false);
+    ofile.close();
+    std::fprintf(out,"coefficient set %u at iteration %u written to %s\n",i,coeffs_pntr->getIterationCounter(),fname.c_str());
+    delete coeffs_pntr;
+    delete aux_coeffs_pntr;
+  }
+  std::fclose(fp);
+}
+
+
+void VesCheckpoint::convertCoeffsFileToCheckpoint(const std::string& input_fname, const std::string& output_fname, FILE* out, Communicator& pc) {
+  std::string field_indices_prefix = "idx_";
+  std::string field_shape_prefix = "shape_";
+  IFile ifile;
+  ifile.link(pc);
+  ifile.open(input_fname);
+  // the list of fields also includes the constant fields of the header
+  std::vector<std::string> fields;
+  ifile.scanFieldList(fields);
+  std::vector<std::string> header_fields;
+  header_fields.push_back("index");
+  header_fields.push_back("description");
+  header_fields.push_back("time");
+  header_fields.push_back("iteration");
+  header_fields.push_back("type");
+  header_fields.push_back("ndimensions");
+  header_fields.push_back("ncoeffs_total");
+  std::vector<std::string> dimension_labels;
+  std::vector<std::string> data_labels;
+  for(unsigned int i=0; i<fields.size(); i++) {
+    if(fields[i].compare(0,field_indices_prefix.size(),field_indices_prefix)==0) {
+      dimension_labels.push_back(fields[i].substr(field_indices_prefix.size()));
+    }
+    else if(fields[i].compare(0,field_shape_prefix.size(),field_shape_prefix)!=0 &&
+            std::find(header_fields.begin(),header_fields.end(),fields[i])==header_fields.end()) {
+      data_labels.push_back(fields[i]);
+    }
+  }
+  if(dimension_labels.size()==0 || data_labels.size()==0 || data_labels.size()>2) {
+    plumed_merror("the file "+input_fname+" is not a coefficient file with the coefficients and optionally the auxiliary coefficients");
+  }
+  ifile.allowIgnoredFields();
+  std::string coeffs_type;
+  ifile.scanField("type",coeffs_type);
+  std::vector<unsigned int> indices_shape(dimension_labels.size());
+  for(unsigned int k=0; k<dimension_labels.size(); k++) {
+    int int_tmp;
+    ifile.scanField(field_shape_prefix+dimension_labels[k],int_tmp);
+    indices_shape[k] = static_cast<unsigned int>(int_tmp);
+  }
+  ifile.scanField();
+  ifile.close();
+  //
+  CoeffsVector coeffs(data_labels[0],dimension_labels,indices_shape,pc,true);
+  coeffs.setTypeFromString(coeffs_type);
+  coeffs.readFromFile(input_fname,false,false);
+  // the auxiliary coefficients are labeled in the same way as in the optimizers
+  CoeffsVector aux_coeffs(coeffs);
+  if(data_labels.size()==2) {
+    aux_coeffs.setLabels(data_labels[1]);
+    aux_coeffs.readFromFile(input_fname,false,false);
+  }
+  else {
+    std::string aux_label = data_labels[0];
+    if(aux_label.find("coeffs")!=std::string::npos) {
+      aux_label.replace(aux_label.find("coeffs"), std::string("coeffs").length(), "aux_coeffs");
+    }
+    else {
+      aux_label += "_aux";
+    }
+    aux_coeffs.setLabels(aux_label);
+  }
+  //
+  if(pc.Get_rank()==0) {
+    std::FILE* fp = std::fopen(output_fname.c_str(),"wb");
+    if(fp==NULL) {plumed_merror("cannot open the checkpoint file "+output_fname+" for writing");}
+    Optimizer::writeCheckpointHeader(fp,1);
+    coeffs.writeToBinaryFile(fp);
+    aux_coeffs.writeToBinaryFile(fp);
+    // no averaged gradient and no sampled averages
+    unsigned int zero = 0;
+    VesTools::writeBinary(fp,zero);
+    VesTools::writeBinary(fp,zero);
+    VesTools::writeBinary(fp,std::vector<double>(0));
+    VesTools::writeBinary(fp,std::vector<double>(0));
+    std::fclose(fp);
+  }
+  std::fprintf(out,"coefficients at iteration %u written to %s\n",coeffs.getIterationCounter(),output_fname.c_str());
+}
+
+
+}
+}
@@ -33,6 +33,7 @@
 #include "core/ActionRegister.h"
 #include "core/ActionSet.h"
 #include "core/PlumedMain.h"
+#include "tools/Grid.h"
 
 
 namespace PLMD {
@@ -326,6 +327,7 @@ void VesLinearExpansion::registerKeywords( Keywords& keys ) {
   //
   keys.use("ARG");
   keys.add("compulsory","BASIS_FUNCTIONS","the label of the one dimensional basis functions that should be used.");
+  keys.addFlag("SEPARABLE_EVALUATION",false,"evaluate the bias by contracting the coefficients one dimension at a time instead of looping over all the coefficients. This is faster for biases in two or more dimensions with many basis functions.");
   keys.addOutputComponent("force2","default","the instantaneous value of the squared force due to this bias potential.");
 }
 
@@ -338,6 +340,8 @@ VesLinearExpansion::VesLinearExpansion(const ActionOptions&ao):
 {
   std::vector<std::string> basisf_labels;
   parseMultipleValues("BASIS_FUNCTIONS",basisf_labels,nargs_);
+  bool separable_evaluation=false;
+  parseFlag("SEPARABLE_EVALUATION",separable_evaluation);
   checkRead();
 
   std::string error_msg = "";
@@ -366,6 +370,10 @@ VesLinearExpansion::VesLinearExpansion(const ActionOptions&ao):
   bias_expansion_pntr_ = new LinearBasisSetExpansion(getLabel(),getBeta(),comm,args_pntrs,basisf_pntrs_,getCoeffsPntr());
   bias_expansion_pntr_->linkVesBias(this);
   bias_expansion_pntr_->setGridBins(this->getGridBins());
+  if(separable_evaluation) {
+    bias_expansion_pntr_->enableSeparableEvaluation();
+    log.printf("  using separable evaluation of the bias where the coefficients are contracted one dimension at a time\n");
+  }
   //
 
 
@@ -408,9 +416,10 @@ VesLinearExpansion::~VesLinearExpansion() {
 
 void VesLinearExpansion::calculate() {
 
-  std::vector<double> cv_values(nargs_);
-  std::vector<double> forces(nargs_);
-  std::vector<double> coeffsderivs_values(ncoeffs_);
+  // the workspace of the bias expansion is used to avoid allocating memory at each step
+  std::vector<double>& cv_values = bias_expansion_pntr_->ArgsValuesWorkspace();
+  std::vector<double>& forces = bias_expansion_pntr_->ForcesWorkspace();
+  std::vector<double>& coeffsderivs_values = bias_expansion_pntr_->CoeffsDerivsValuesWorkspace();
 
   for(unsigned int k=0; k<nargs_; k++) {
     cv_values[k]=getArgument(k);
@@ -456,14 +465,10 @@ void VesLinearExpansion::setupBiasFileOutput() {
 
 void VesLinearExpansion::writeBiasToFile() {
   bias_expansion_pntr_->updateBiasGrid();
-  OFile* ofile_pntr = getOFile(getCurrentBiasOutputFilename(),useMultipleWalkers());
-  bias_expansion_pntr_->writeBiasGridToFile(*ofile_pntr);
-  ofile_pntr->close(); delete ofile_pntr;
+  writeGridToFile(bias_expansion_pntr_->getPntrToBiasGrid(),getCurrentBiasOutputFilename(),useMultipleWalkers());
   if(biasCutoffActive()) {
     bias_expansion_pntr_->updateBiasWithoutCutoffGrid();
-    OFile* ofile_pntr2 = getOFile(getCurrentBiasOutputFilename("without-cutoff"),useMultipleWalkers());
-    bias_expansion_pntr_->writeBiasWithoutCutoffGridToFile(*ofile_pntr2);
-    ofile_pntr2->close(); delete ofile_pntr2;
+    writeGridToFile(bias_expansion_pntr_->getPntrToBiasWithoutCutoffGrid(),getCurrentBiasOutputFilename("without-cutoff"),useMultipleWalkers());
   }
 }
 
@@ -480,9 +485,7 @@ void VesLinearExpansion::setupFesFileOutput() {
 
 void VesLinearExpansion::writeFesToFile() {
   bias_expansion_pntr_->updateFesGrid();
-  OFile* ofile_pntr = getOFile(getCurrentFesOutputFilename(),useMultipleWalkers());
-  bias_expansion_pntr_->writeFesGridToFile(*ofile_pntr);
-  ofile_pntr->close(); delete ofile_pntr;
+  writeGridToFile(bias_expansion_pntr_->getPntrToFesGrid(),getCurrentFesOutputFilename(),useMultipleWalkers());
 }
 
 
@@ -504,21 +507,16 @@ void VesLinearExpansion::writeFesProjToFile() {
     std::string suffix;
     Tools::convert(i+1,suffix);
     suffix = "proj-" + suffix;
-    OFile* ofile_pntr = getOFile(getCurrentFesOutputFilename(suffix),useMultipleWalkers());
     std::vector<std::string> args = getProjectionArgument(i);
-    bias_expansion_pntr_->writeFesProjGridToFile(args,*ofile_pntr);
-    ofile_pntr->close(); delete ofile_pntr;
+    Grid proj_grid = bias_expansion_pntr_->getFesProjGrid(args);
+    writeGridToFile(&proj_grid,getCurrentFesOutputFilename(suffix),useMultipleWalkers());
   }
 }
 
 
 void VesLinearExpansion::writeTargetDistToFile() {
-  OFile* ofile1_pntr = getOFile(getCurrentTargetDistOutputFilename(),useMultipleWalkers());
-  OFile* ofile2_pntr = getOFile(getCurrentTargetDistOutputFilename("log"),useMultipleWalkers());
-  bias_expansion_pntr_->writeTargetDistGridToFile(*ofile1_pntr);
-  bias_expansion_pntr_->writeLogTargetDistGridToFile(*ofile2_pntr);
-  ofile1_pntr->close(); delete ofile1_pntr;
-  ofile2_pntr->close(); delete ofile2_pntr;
+  writeGridToFile(bias_expansion_pntr_->getPntrToTargetDistGrid(),getCurrentTargetDistOutputFilename(),useMultipleWalkers());
+  writeGridToFile(bias_expansion_pntr_->getPntrToLogTargetDistGrid(),getCurrentTargetDistOutputFilename("log"),useMultipleWalkers());
 }
 
 
@@ -527,10 +525,13 @@ void VesLinearExpansion::writeTargetDistProjToFile() {
     std::string suffix;
     Tools::convert(i+1,suffix);
     suffix = "proj-" + suffix;
-    OFile* ofile_pntr = getOFile(getCurrentTargetDistOutputFilename(suffix),useMultipleWalkers());
+    if(bias_expansion_pntr_->getPntrToTargetDistGrid()==NULL) {
+      writeGridToFile(NULL,getCurrentTargetDistOutputFilename(suffix),useMultipleWalkers());
+      continue;
+    }
     std::vector<std::string> args = getProjectionArgument(i);
-    bias_expansion_pntr_->writeTargetDistProjGridToFile(args,*ofile_pntr);
-    ofile_pntr->close(); delete ofile_pntr;
+    Grid proj_grid = bias_expansion_pntr_->getTargetDistProjGrid(args);
+    writeGridToFile(&proj_grid,getCurrentTargetDistOutputFilename(suffix),useMultipleWalkers());
   }
 }
 
@@ -90,5 +90,36 @@ unsigned int VesTools::getGridFileInfo(const std::string& filepath, std::string&
 }
 
 
+void VesTools::writeBinary(std::FILE* fp, const std::string& str) {
+  unsigned int size = str.size();
+  writeBinary(fp,size);
+  if(size>0 && std::fwrite(str.data(),sizeof(char),size,fp)!=size) {plumed_merror("error in writing to binary file");}
+}
+
+
+void VesTools::readBinary(std::FILE* fp, std::string& str) {
+  unsigned int size = 0;
+  readBinary(fp,size);
+  std::vector<char> buffer(size);
+  if(size>0 && std::fread(buffer.data(),sizeof(char),size,fp)!=size) {plumed_merror("error in reading from binary file, the file is probably truncated");}
+  str.assign(buffer.begin(),buffer.end());
+}
+
+
+void VesTools::writeBinary(std::FILE* fp, const std::vector<double>& values) {
+  unsigned long size = values.size();
+  writeBinary(fp,size);
+  if(size>0 && std::fwrite(values.data(),sizeof(double),size,fp)!=size) {plumed_merror("error in writing to binary file");}
+}
+
+
+void VesTools::readBinary(std::FILE* fp, std::vector<double>& values) {
+  unsigned long size = 0;
+  readBinary(fp,size);
+  values.resize(size);
+  if(size>0 && std::fread(values.data(),sizeof(double),size,fp)!=size) {plumed_merror("error in reading from binary file, the file is probably truncated");}
+}
+
+
 }
 }
@@ -27,8 +27,10 @@
 #include <iomanip>
 #include <limits>
 #include <vector>
+#include <cstdio>
 
 #include "core/ActionSet.h"
+#include "tools/Exception.h"
 
 
 namespace PLMD {
@@ -45,6 +47,15 @@ public:
   // copy grid values
   static void copyGridValues(Grid* grid_pntr_orig, Grid* grid_pntr_copy);
   static unsigned int getGridFileInfo(const std::string&, std::string&, std::vector<std::string>&, std::vector<std::string>&, std::vector<std::string>&, std::vector<bool>&, std::vector<unsigned int>&, bool&);
+  // split n indices into nparts contiguous blocks of (almost) equal size and get the range [begin,end) of a given block
+  static void getBlockOfIndices(const size_t n, const size_t part, const size_t nparts, size_t& begin, size_t& end);
+  // unformatted input/output of plain values, strings and vectors used for the binary checkpoint files
+  template<typename T> static void writeBinary(std::FILE*, const T&);
+  template<typename T> static void readBinary(std::FILE*, T&);
+  static void writeBinary(std::FILE*, const std::string&);
+  static void readBinary(std::FILE*, std::string&);
+  static void writeBinary(std::FILE*, const std::vector<double>&);
+  static void readBinary(std::FILE*, std::vector<double>&);
   //
   template<typename T> static std::vector<std::string> getLabelsOfAvailableActions(const ActionSet&);
   template<typename T> static T getPointerFromLabel(const std::string&, const ActionSet&, std::string&);
@@ -67,6 +78,27 @@ void VesTools::convertDbl2Str(const double value,std::string& str) {
 }
 
 
+inline
+void VesTools::getBlockOfIndices(const size_t n, const size_t part, const size_t nparts, size_t& begin, size_t& end) {
+  const size_t block_size = n/nparts;
+  const size_t remainder = n%nparts;
+  begin = part*block_size + (part<remainder ? part : remainder);
+  end = begin + block_size + (part<remainder ? 1 : 0);
+}
+
+
+template<typename T>
+void VesTools::writeBinary(std::FILE* fp, const T& value) {
+  if(std::fwrite(&value,sizeof(T),1,fp)!=1) {plumed_merror("error in writing to binary file");}
+}
+
+
+template<typename T>
+void VesTools::readBinary(std::FILE* fp, T& value) {
+  if(std::fread(&value,sizeof(T),1,fp)!=1) {plumed_merror("error in reading from binary file, the file is probably truncated");}
+}
+
+
 template<typename T>
 std::vector<std::string> VesTools::getLabelsOfAvailableActions(const ActionSet& actionset) {
   std::vector<std::string> avail_action_str(0);
@@ -30,6 +30,7 @@
 #include "StoreDataVessel.h"
 #include "tools/OpenMP.h"
 #include "tools/Stopwatch.h"
+#include <algorithm>
 
 using namespace std;
 namespace PLMD {
@@ -45,6 +46,8 @@ void ActionWithVessel::registerKeywords(Keywords& keys) {
   keys.addFlag("SERIAL",false,"do the calculation in serial.  Do not parallelize");
   keys.addFlag("LOWMEM",false,"lower the memory requirements");
   keys.addFlag("TIMINGS",false,"output information on the timings of the various parts of the calculation");
+  keys.add("compulsory","TASK_CHUNK","0","the number of tasks that an OpenMP thread takes at a time.  Tasks are handed out dynamically, "
+           "so that threads that complete their tasks early take more work.  If this is zero a value is chosen automatically");
   keys.reserveFlag("HIGHMEM",false,"use a more memory intensive version of this collective variable");
   keys.add( vesselRegister().getKeywords() );
 }
@@ -86,6 +89,9 @@ ActionWithVessel::ActionWithVessel(const ActionOptions&ao):
     log.printf(" Ignoring contributions less than %f \n",tolerance);
   }
   parseFlag("TIMINGS",timers);
+  task_chunk=0;
+  if( keywords.exists("TASK_CHUNK") ) parse("TASK_CHUNK",task_chunk);
+  if( task_chunk>0 ) log.printf("  OpenMP threads take tasks in chunks of %u\n",task_chunk);
   stopwatch.start(); stopwatch.pause();
 }
 
@@ -291,16 +297,21 @@ void ActionWithVessel::runAllTasks() {
   // Build storage stuff for loop
   // std::vector<double> buffer( bufsize, 0.0 );
 
+  // Tasks are handed out in chunks, by default small enough to balance tasks with very different costs
+  unsigned chunk=task_chunk;
+  if( chunk==0 ) chunk=std::max( 1U, nactive_tasks/(stride*nt*32) );
+  // Buffers for each thread, allocated only by threads contributing to the sum
+  std::vector<std::vector<double> > omp_buffer( nt>1 ? nt : 0 );
+
   if(timers) stopwatch.start("2 Loop over tasks");
   #pragma omp parallel num_threads(nt)
   {
-    std::vector<double> omp_buffer;
-    if( nt>1 ) omp_buffer.resize( bufsize, 0.0 );
+    const unsigned tid=OpenMP::getThreadNum();
     MultiValue myvals( getNumberOfQuantities(), getNumberOfDerivatives() );
     MultiValue bvals( getNumberOfQuantities(), getNumberOfDerivatives() );
     myvals.clearAll(); bvals.clearAll();
 
-    #pragma omp for nowait
+    #pragma omp for schedule(dynamic,chunk)
     for(unsigned i=rank; i<nactive_tasks; i+=stride) {
       // Calculate the stuff in the loop for this action
       performTask( indexOfTaskInFullList[i], partialTaskList[i], myvals );
@@ -318,7 +329,8 @@ void ActionWithVessel::runAllTasks() {
       // If the contribution of this quantity is very small at neighbour list time ignore it
       // untill next neighbour list time
       if( nt>1 ) {
-        calculateAllVessels( indexOfTaskInFullList[i], myvals, bvals, omp_buffer, der_list );
+        if( omp_buffer[tid].empty() ) omp_buffer[tid].assign( bufsize, 0.0 );
+        calculateAllVessels( indexOfTaskInFullList[i], myvals, bvals, omp_buffer[tid], der_list );
       } else {
         calculateAllVessels( indexOfTaskInFullList[i], myvals, bvals, buffer, der_list );
       }
@@ -326,8 +338,21 @@ void ActionWithVessel::runAllTasks() {
       // Clear the value
       myvals.clearAll();
     }
-    #pragma omp critical
-    if(nt>1) for(unsigned i=0; i<bufsize; ++i) buffer[i]+=omp_buffer[i];
+    // Sum the buffers of the threads, each thread takes care of some blocks of the buffer
+    // and buffers of threads that did not contribute are skipped
+    if( nt>1 ) {
+      const unsigned blocksize=4096;
+      const unsigned nblocks=(bufsize+blocksize-1)/blocksize;
+      #pragma omp for
+      for(unsigned b=0; b<nblocks; ++b) {
+        const unsigned iend=std::min( bufsize, (b+1)*blocksize );
+        for(unsigned t=0; t<nt; ++t) {
+          if( omp_buffer[t].empty() ) continue;
+          const double* tbuf=omp_buffer[t].data();
+          for(unsigned i=b*blocksize; i<iend; ++i) buffer[i]+=tbuf[i];
+        }
+      }
+    }
   }
   if(timers) stopwatch.stop("2 Loop over tasks");
   // Turn back on derivative calculation
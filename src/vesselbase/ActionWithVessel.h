@@ -87,6 +87,8 @@ private:
   std::vector<double> buffer;
 /// Do we want to output information on the timings of different parts of the calculation
   bool timers;
+/// The number of tasks that an OpenMP thread takes at a time (zero means automatic)
+  unsigned task_chunk;
   ForwardDecl<Stopwatch> stopwatch_fwd;
 /// The stopwatch that times the different parts of the calculation
   Stopwatch& stopwatch=*stopwatch_fwd;